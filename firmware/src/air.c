@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "hardware/gpio.h"
 #include "hardware/adc.h"
@@ -23,7 +24,13 @@
 
 static const uint8_t TOF_LIST[] = TOF_MUX_LIST;
 static uint8_t tof_model[count_of(TOF_LIST)];
+
+/* I2C IRQ fills distance_scan, air_update() takes each sensor that
+   answered, a dropped read only leaves that one at its last value */
 static uint16_t distances[count_of(TOF_LIST)];
+static uint16_t distance_scan[count_of(TOF_LIST)];
+static volatile uint32_t tof_scanned_mask = 0;
+static uint8_t tof_raw[count_of(TOF_LIST)][2];
 
 static const uint8_t IR_ABC[] = IR_GROUP_ABC_GPIO;
 static const uint8_t IR_SIG[] = IR_SIG_ADC_CHANNEL;
@@ -33,9 +40,11 @@ static uint16_t ir_raw[6];
 static bool ir_blocked[6];
 #define IR_DEBOUNCE_PERCENT 90
 
+static void ir_read();
+
 static void air_init_tof()
 {
-    i2c_init(I2C_PORT, I2C_FREQ);
+    i2c_scan_bus_init(I2C_FREQ);
     gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);
     gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);
     gpio_pull_up(I2C_SDA);
@@ -74,6 +83,10 @@ static void air_init_ir()
         adc_init();
         adc_gpio_init(26 + IR_SIG[i]);
     }
+    /* one round over all groups, a beam never read looks blocked */
+    for (int i = 0; i < count_of(IR_ABC); i++) {
+        ir_read();
+    }
 }
 
 void air_init()
@@ -166,16 +179,53 @@ uint16_t air_ir_raw(uint8_t index)
     return ir_raw[index];
 }
 
-static void air_update_tof()
+static void vl53l0x_scanned(int index, uint16_t range, bool ok)
+{
+    if (ok) {
+        distance_scan[index] = range * 10;
+        tof_scanned_mask |= 1 << index;
+    }
+}
+
+static void gp2y0e_scanned(const i2c_txn_t *txn, bool ok)
 {
+    int index = txn->arg;
+    if (ok) {
+        distance_scan[index] = gp2y0e_dist16_decode(tof_raw[index]) * 10;
+        tof_scanned_mask |= 1 << index;
+    }
+}
+
+void air_scan()
+{
+    if (chu_cfg->ir.enabled) {
+        return;
+    }
+
+    tof_scanned_mask = 0;
+
     for (int i = 0; i < sizeof(TOF_LIST); i++) {
-        i2c_select(I2C_PORT, 1 << TOF_LIST[i]);
+        if (tof_model[i] == 0) {
+            continue;
+        }
+        i2c_scan_select(1 << TOF_LIST[i]);
         if (tof_model[i] == 1) {
-            distances[i] = readRangeContinuousMillimeters(i) * 10;
+            vl53l0x_scan_range(i, vl53l0x_scanned);
         } else if (tof_model[i] == 2) {
-            distances[i] = gp2y0e_dist16_mm(I2C_PORT) * 10;
+            gp2y0e_scan_dist16(tof_raw[i], gp2y0e_scanned, i);
+        }
+    }
+}
+
+/* bus is idle here */
+static void air_update_tof()
+{
+    for (int i = 0; i < sizeof(TOF_LIST); i++) {
+        if (tof_scanned_mask & (1 << i)) {
+            distances[i] = distance_scan[i];
         }
     }
+    tof_scanned_mask = 0;
 }
 
 static void ir_read()
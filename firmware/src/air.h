@@ -15,6 +15,7 @@ unsigned air_tof_value(uint8_t index);
 uint16_t air_tof_raw(uint8_t index);
 uint16_t air_ir_raw(uint8_t index);
 uint8_t air_bitmap();
+void air_scan();
 void air_update();
 
 #endif
@@ -0,0 +1,162 @@
+/*
+ * Analog Slider Touch Engine
+ * WHowe <github.com/whowechina>
+ *
+ * Touch detection from electrode filtered data and baseline instead of
+ * MPR121's own thresholds, plus sub-key contact positions.
+ * Integer only and hardware independent.
+ */
+
+#include "analog.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* noise is kept in Q4 */
+#define NOISE_SHIFT 4
+#define NOISE_EMA_SHIFT 3
+#define NOISE_MAX (40 << NOISE_SHIFT)
+
+/* thresholds move up with noise: touch by 3x noise, release by 1x */
+#define TOUCH_NOISE_GAIN 3
+#define RELEASE_NOISE_GAIN 1
+
+static struct {
+    uint8_t touch;
+    uint8_t release;
+} thresholds[ANALOG_PAD_NUM];
+
+static int16_t deltas[ANALOG_PAD_NUM];
+static uint16_t noise[ANALOG_PAD_NUM];
+static uint32_t touched = 0;
+
+static uint8_t contacts[ANALOG_MAX_CONTACTS];
+static int contact_num = 0;
+
+void analog_init()
+{
+    for (int i = 0; i < ANALOG_PAD_NUM; i++) {
+        thresholds[i].touch = 22;
+        thresholds[i].release = 15;
+    }
+    memset(deltas, 0, sizeof(deltas));
+    memset(noise, 0, sizeof(noise));
+    touched = 0;
+    contact_num = 0;
+}
+
+void analog_threshold(unsigned pad, uint8_t touch, uint8_t release)
+{
+    if (pad >= ANALOG_PAD_NUM) {
+        return;
+    }
+    thresholds[pad].touch = touch;
+    thresholds[pad].release = release;
+}
+
+static inline void update_noise(int pad, int16_t delta)
+{
+    int diff = delta - deltas[pad];
+    if (diff < 0) {
+        diff = -diff;
+    }
+    int sample = diff << NOISE_SHIFT;
+    int n = noise[pad] + ((sample - noise[pad]) >> NOISE_EMA_SHIFT);
+    noise[pad] = n > NOISE_MAX ? NOISE_MAX : n;
+}
+
+static void detect(const uint16_t *filtered, const uint8_t *baseline,
+                   unsigned first, unsigned end)
+{
+    for (int i = first; i < end; i++) {
+        int16_t delta = (baseline[i] << 2) - (filtered[i] & 0x3ff);
+        bool on = touched & (1 << i);
+
+        int n = noise[i] >> NOISE_SHIFT;
+        if (on) {
+            on = (delta > thresholds[i].release + n * RELEASE_NOISE_GAIN);
+        } else {
+            on = (delta >= thresholds[i].touch + n * TOUCH_NOISE_GAIN);
+            /* only learn noise from an idle pad */
+            if (!on) {
+                update_noise(i, delta);
+            }
+        }
+
+        touched = on ? (touched | (1 << i)) : (touched & ~(1 << i));
+        deltas[i] = delta;
+    }
+}
+
+/* Pads 2k and 2k+1 make key k, a contact is a run of touched keys,
+   its position is the delta weighted centroid including one neighbor key
+   on each side, so a finger between two keys lands in between. */
+static void locate()
+{
+    int32_t weight[ANALOG_KEY_NUM];
+    for (int k = 0; k < ANALOG_KEY_NUM; k++) {
+        int32_t w = 0;
+        if (deltas[k * 2] > 0) {
+            w += deltas[k * 2];
+        }
+        if (deltas[k * 2 + 1] > 0) {
+            w += deltas[k * 2 + 1];
+        }
+        weight[k] = w;
+    }
+
+    contact_num = 0;
+    int k = 0;
+    while ((k < ANALOG_KEY_NUM) && (contact_num < ANALOG_MAX_CONTACTS)) {
+        if (!((touched >> (k * 2)) & 0x03)) {
+            k++;
+            continue;
+        }
+        int start = k;
+        while ((k < ANALOG_KEY_NUM) && ((touched >> (k * 2)) & 0x03)) {
+            k++;
+        }
+        int end = k; // exclusive
+
+        int from = start > 0 ? start - 1 : start;
+        int to = end < ANALOG_KEY_NUM ? end + 1 : end;
+
+        int32_t sum = 0;
+        int32_t moment = 0;
+        for (int i = from; i < to; i++) {
+            sum += weight[i];
+            moment += weight[i] * (i * 256 + 128); // key center in Q8
+        }
+
+        int32_t center = sum > 0 ? moment / sum : (start + end) * 128;
+        contacts[contact_num] = 1 + center * 254 / (ANALOG_KEY_NUM * 256);
+        contact_num++;
+    }
+}
+
+uint32_t analog_process(const uint16_t *filtered, const uint8_t *baseline)
+{
+    return analog_process_part(filtered, baseline, 0, ANALOG_PAD_NUM);
+}
+
+uint32_t analog_process_part(const uint16_t *filtered, const uint8_t *baseline,
+                             unsigned first, unsigned num)
+{
+    unsigned end = first + num;
+    detect(filtered, baseline, first, end < ANALOG_PAD_NUM ? end : ANALOG_PAD_NUM);
+    locate();
+    return touched;
+}
+
+const int16_t *analog_delta()
+{
+    return deltas;
+}
+
+int analog_contacts(uint8_t pos[ANALOG_MAX_CONTACTS])
+{
+    memset(pos, 0, ANALOG_MAX_CONTACTS);
+    memcpy(pos, contacts, contact_num);
+    return contact_num;
+}
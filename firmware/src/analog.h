@@ -0,0 +1,31 @@
+/*
+ * Analog Slider Touch Engine
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef ANALOG_H
+#define ANALOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ANALOG_PAD_NUM 32
+#define ANALOG_KEY_NUM 16
+#define ANALOG_MAX_CONTACTS 4
+
+void analog_init();
+void analog_threshold(unsigned pad, uint8_t touch, uint8_t release);
+
+/* filtered: 10-bit MPR121 filtered data, baseline: its 8-bit baseline
+   Returns the touched pad bitmap */
+uint32_t analog_process(const uint16_t *filtered, const uint8_t *baseline);
+/* Same, when only pads first..first+num-1 have been read again. Noise is
+   learned from sample to sample, so stale pads must not be fed again. */
+uint32_t analog_process_part(const uint16_t *filtered, const uint8_t *baseline,
+                             unsigned first, unsigned num);
+
+const int16_t *analog_delta();
+/* Positions of contacts along the slider, 1..255, 0 means none */
+int analog_contacts(uint8_t pos[ANALOG_MAX_CONTACTS]);
+
+#endif
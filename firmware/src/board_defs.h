@@ -12,6 +12,13 @@
 
 #define I2C_HUB_EN 19
 
+/* MPR121 IRQ outputs (open drain, active low), 0x5A, 0x5B, 0x5C.
+   Not routed on the stock PCB, only for boards with the ~IRQ pins of
+   U3/U4/U5 wired to these GPIOs by hand. */
+#ifdef CHU_MOD_TOUCH_IRQ
+#define MPR121_IRQ_GPIO { 6, 7, 8 }
+#endif
+
 #define TOF_MUX_LIST { 1, 2, 0, 4, 5 }
 
 #define IR_GROUP_ABC_GPIO { 3, 4, 5 }
@@ -86,9 +86,18 @@ void cli_fps_count(int core)
     counter[core] = 0;
 }
 
+static void (*fps_extra)() = NULL;
+void cli_fps_extra(void (*disp)())
+{
+    fps_extra = disp;
+}
+
 static void handle_fps(int argc, char *argv[])
 {
     printf("FPS: core 0: %d, core 1: %d\n", fps[0], fps[1]);
+    if (fps_extra) {
+        fps_extra();
+    }
 }
 
 static void handle_update(int argc, char *argv[])
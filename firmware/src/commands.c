@@ -10,10 +10,18 @@
 #include "config.h"
 #include "air.h"
 #include "slider.h"
+#include "rgb.h"
 #include "save.h"
 #include "cli.h"
+#include "latency.h"
+#include "trace.h"
+#include "perf.h"
+#include "report.h"
+#include "profile.h"
+#include "board_defs.h"
 
 #include "i2c_hub.h"
+#include "i2c_scan.h"
 
 #include "nfc.h"
 #include "aime.h"
@@ -30,12 +38,24 @@ static void disp_colors()
     printf("  Gap: %06lx\n", chu_cfg->colors.gap);
 }
 
+static const char *key_styles[] = { "classic", "fade", "ripple" };
+static const char *gap_styles[] = { "rainbow", "breath", "solid" };
+static const char *tof_styles[] = { "distance", "breath" };
+
 static void disp_style()
 {
     printf("[Style]\n");
-    printf("  Key: %d, Gap: %d, ToF: %d, Level: %d\n",
-           chu_cfg->style.key, chu_cfg->style.gap,
-           chu_cfg->style.tof, chu_cfg->style.level);
+    printf("  Key: %s, Gap: %s, ToF: %s, Level: %d\n",
+           key_styles[chu_cfg->style.key], gap_styles[chu_cfg->style.gap],
+           tof_styles[chu_cfg->style.tof], chu_cfg->style.level);
+    const uint8_t *fix[] = { chu_cfg->color_fix.key, chu_cfg->color_fix.gap,
+                             chu_cfg->color_fix.tower };
+    const char *names[] = { "Key", "Gap", "Tower" };
+    printf("  Color fix (R/G/B):");
+    for (int i = 0; i < count_of(fix); i++) {
+        printf(" %s %d/%d/%d", names[i], fix[i][0], fix[i][1], fix[i][2]);
+    }
+    printf("\n");
 }
 
 static void disp_tof()
@@ -87,6 +107,9 @@ static void disp_hid()
     printf("  Joy: %s, NKRO: %s.\n", 
            chu_cfg->hid.joy ? "on" : "off",
            chu_cfg->hid.nkro ? "on" : "off" );
+    const char *keys = chu_cfg->nkro.keymap;
+    printf("  Keymap: %.32s\n", keys);
+    printf("    Air: %.6s, Aux: %.3s\n", keys + 32, keys + 38);
 }
 
 static void disp_aime()
@@ -101,11 +124,28 @@ static void disp_tweak()
 {
     printf("[Tweak]\n");
     printf("  Skip Splitter LED: %s\n", chu_cfg->tweak.skip_split_led ? "ON" : "OFF");
+#ifdef MPR121_IRQ_GPIO
+    printf("  Touch IRQ: %s\n", chu_cfg->tweak.touch_irq ? "ON" : "OFF");
+#else
+    printf("  Touch IRQ: N/A (not wired)\n");
+#endif
+    const char *modes[] = { "MPR121", "Software", "Software + Positions" };
+    printf("  Touch Mode: %s\n", modes[chu_cfg->tweak.touch_mode]);
+}
+
+static void disp_profile()
+{
+    printf("[Profile]\n");
+    printf("  Active: %s, All:", profile_name(profile_active()));
+    for (int i = 0; i < PROFILE_NUM; i++) {
+        printf(" %d:%s", i + 1, profile_name(i));
+    }
+    printf("\n");
 }
 
 void handle_display(int argc, char *argv[])
 {
-    const char *usage = "Usage: display [colors|style|tof|ir|sense|hid|aime|tweak]\n";
+    const char *usage = "Usage: display [colors|style|tof|ir|sense|hid|aime|tweak|profile]\n";
     if (argc > 1) {
         printf(usage);
         return;
@@ -120,10 +160,11 @@ void handle_display(int argc, char *argv[])
         disp_hid();
         disp_aime();
         disp_tweak();
+        disp_profile();
         return;
     }
 
-    const char *choices[] = {"colors", "style", "tof", "ir", "sense", "hid", "aime", "tweak"};
+    const char *choices[] = {"colors", "style", "tof", "ir", "sense", "hid", "aime", "tweak", "profile"};
     switch (cli_match_prefix(choices, count_of(choices), argv[0])) {
         case 0:
             disp_colors();
@@ -149,6 +190,9 @@ void handle_display(int argc, char *argv[])
         case 7:
             disp_tweak();
             break;
+        case 8:
+            disp_profile();
+            break;
         default:
             printf(usage);
             break;
@@ -170,6 +214,75 @@ static void handle_level(int argc, char *argv[])
     }
 
     chu_cfg->style.level = level;
+    rgb_update_level();
+    config_changed();
+    disp_style();
+}
+
+static void handle_style(int argc, char *argv[])
+{
+    const char *usage = "Usage: style key <classic|fade|ripple>\n"
+                        "       style gap <rainbow|breath|solid>\n"
+                        "       style tof <distance|breath>\n";
+    if (argc != 2) {
+        printf("%s", usage);
+        return;
+    }
+
+    const char *parts[] = { "key", "gap", "tof" };
+    int part = cli_match_prefix(parts, count_of(parts), argv[0]);
+
+    int style = -1;
+    if (part == 0) {
+        style = cli_match_prefix(key_styles, count_of(key_styles), argv[1]);
+    } else if (part == 1) {
+        style = cli_match_prefix(gap_styles, count_of(gap_styles), argv[1]);
+    } else if (part == 2) {
+        style = cli_match_prefix(tof_styles, count_of(tof_styles), argv[1]);
+    }
+    if (style < 0) {
+        printf("%s", usage);
+        return;
+    }
+
+    uint8_t *styles[] = { &chu_cfg->style.key, &chu_cfg->style.gap,
+                          &chu_cfg->style.tof };
+    *styles[part] = style;
+    config_changed();
+    disp_style();
+}
+
+static void handle_color_fix(int argc, char *argv[])
+{
+    const char *usage = "Usage: colorfix <key|gap|tower> <r> <g> <b>\n"
+                        "  r, g, b: 0..255, 255 is 100%\n";
+    if (argc != 4) {
+        printf("%s", usage);
+        return;
+    }
+
+    const char *groups[] = { "key", "gap", "tower" };
+    int match = cli_match_prefix(groups, count_of(groups), argv[0]);
+    if (match < 0) {
+        printf("%s", usage);
+        return;
+    }
+
+    int rgb[3];
+    for (int i = 0; i < 3; i++) {
+        rgb[i] = cli_extract_non_neg_int(argv[i + 1], 0);
+        if ((rgb[i] < 0) || (rgb[i] > 255)) {
+            printf("%s", usage);
+            return;
+        }
+    }
+
+    uint8_t *fix[] = { chu_cfg->color_fix.key, chu_cfg->color_fix.gap,
+                       chu_cfg->color_fix.tower };
+    for (int i = 0; i < 3; i++) {
+        fix[match][i] = rgb[i];
+    }
+    rgb_update_level();
     config_changed();
     disp_style();
 }
@@ -196,6 +309,136 @@ static void handle_stat(int argc, char *argv[])
     }
 }
 
+static void handle_latency(int argc, char *argv[])
+{
+    if (argc == 0) {
+        printf("Touch latency (us), last %d touches:\n", LATENCY_RING_SIZE);
+        printf("  Stage |  Count |  Min |  Avg |  P99 |  Max\n");
+        for (int i = 0; i < LATENCY_STAGE_NUM; i++) {
+            latency_stat_t stat;
+            latency_stat(i, &stat);
+            printf("  %5s | %6lu | %4lu | %4lu | %4lu | %4lu\n",
+                   latency_stage_name(i), stat.count,
+                   stat.min, stat.avg, stat.p99, stat.max);
+        }
+        printf("Touch to HID report histogram (us):\n");
+        for (int i = 0; i < LATENCY_BUCKET_NUM; i++) {
+            if (i < LATENCY_BUCKET_NUM - 1) {
+                printf("  %4d-%4d: %lu\n", i * LATENCY_BUCKET_US,
+                       (i + 1) * LATENCY_BUCKET_US - 1, latency_hist_count(i));
+            } else {
+                printf("  %4d+    : %lu\n", i * LATENCY_BUCKET_US,
+                       latency_hist_count(i));
+            }
+        }
+    } else if ((argc == 1) &&
+               (strncasecmp(argv[0], "reset", strlen(argv[0])) == 0)) {
+        latency_reset();
+    } else {
+        printf("Usage: latency [reset]\n");
+    }
+}
+
+static void handle_perf(int argc, char *argv[])
+{
+    const char *usage = "Usage: perf [reset|dump]\n";
+    if (argc > 1) {
+        printf("%s", usage);
+        return;
+    }
+
+    if (argc == 0) {
+        for (int core = 0; core < 2; core++) {
+            perf_core_t stat;
+            perf_core_stat(core, &stat);
+            printf("Core %d: %lu fps, %lu us busy\n", core, stat.frames, stat.busy);
+            printf("  %lu missed, %lu dropped, %lu deferred\n",
+                   stat.missed, stat.dropped, stat.deferred);
+        }
+        uint32_t aborted, dropped;
+        i2c_scan_stat(&aborted, &dropped);
+        printf("I2C scan: %lu aborted, %lu dropped\n", aborted, dropped);
+        save_stat_t save;
+        save_stat(&save);
+        printf("Save: %lu saves, %lu flash ops, longest input gap %lu us (last %lu us)\n",
+               save.saves, save.flash_ops, save.max_stall_us, save.last_stall_us);
+        printf("  Section | Core |  Count |  Avg |  Max\n");
+        for (int i = 0; i < PERF_SECTION_NUM; i++) {
+            perf_stat_t stat;
+            perf_stat(i, &stat);
+            printf("  %7s | %4d | %6lu | %4lu | %4lu\n", perf_name(i),
+                   perf_core(i), stat.count, stat.avg, stat.max);
+        }
+        return;
+    }
+
+    const char *options[] = { "reset", "dump" };
+    int match = cli_match_prefix(options, count_of(options), argv[0]);
+    if (match == 0) {
+        perf_reset();
+    } else if (match == 1) {
+        for (int core = 0; core < 2; core++) {
+            perf_core_t stat;
+            perf_core_stat(core, &stat);
+            printf("core,%d,%lu,%lu,%lu,%lu,%lu\n", core, stat.frames, stat.busy,
+                   stat.missed, stat.dropped, stat.deferred);
+        }
+        uint32_t aborted, dropped;
+        i2c_scan_stat(&aborted, &dropped);
+        printf("i2c,%lu,%lu\n", aborted, dropped);
+        save_stat_t save;
+        save_stat(&save);
+        printf("save,%lu,%lu,%lu,%lu\n", save.saves, save.flash_ops,
+               save.max_stall_us, save.last_stall_us);
+        for (int i = 0; i < PERF_SECTION_NUM; i++) {
+            perf_stat_t stat;
+            perf_stat(i, &stat);
+            printf("section,%s,%d,%lu,%lu,%lu\n", perf_name(i), perf_core(i),
+                   stat.count, stat.avg, stat.max);
+        }
+    } else {
+        printf("%s", usage);
+    }
+}
+
+static void handle_profile(int argc, char *argv[])
+{
+    const char *usage = "Usage: profile <name|1..%d>\n"
+                        "       profile rename <name>\n"
+                        "  name: up to %d letters, digits, '-' or '_'\n"
+                        "  SERVICE + START also switches to the next profile.\n";
+    if (argc == 0) {
+        disp_profile();
+        return;
+    }
+
+    if ((argc == 2) && (strncasecmp(argv[0], "rename", strlen(argv[0])) == 0)) {
+        if (!profile_rename(argv[1])) {
+            printf(usage, PROFILE_NUM, PROFILE_NAME_LEN - 1);
+            return;
+        }
+        disp_profile();
+        return;
+    }
+
+    if (argc != 1) {
+        printf(usage, PROFILE_NUM, PROFILE_NAME_LEN - 1);
+        return;
+    }
+
+    int index = profile_find(argv[0]);
+    if (index < 0) {
+        index = cli_extract_non_neg_int(argv[0], 0) - 1;
+    }
+    if ((index < 0) || (index >= PROFILE_NUM)) {
+        printf(usage, PROFILE_NUM, PROFILE_NAME_LEN - 1);
+        return;
+    }
+
+    profile_switch(index);
+    disp_profile();
+}
+
 static void handle_hid(int argc, char *argv[])
 {
     const char *usage = "Usage: hid <joy|nkro|both>\n";
@@ -217,6 +460,37 @@ static void handle_hid(int argc, char *argv[])
     disp_hid();
 }
 
+static void handle_keymap(int argc, char *argv[])
+{
+    const char *usage = "Usage: keymap <key> <char|0xNN>\n"
+                        "       keymap reset\n"
+                        "  key: 0..31 slider, 32..37 air, 38..40 aux\n";
+
+    if ((argc == 1) && (strncasecmp(argv[0], "reset", strlen(argv[0])) == 0)) {
+        strcpy(chu_cfg->nkro.keymap, NKRO_KEYMAP);
+    } else if (argc == 2) {
+        int key = cli_extract_non_neg_int(argv[0], 0);
+        int ascii = -1;
+        if (strlen(argv[1]) == 1) {
+            ascii = argv[1][0];
+        } else if (strncasecmp(argv[1], "0x", 2) == 0) {
+            ascii = strtol(argv[1], NULL, 16);
+        }
+        if ((key < 0) || (key >= NKRO_KEY_NUM) || (ascii <= 0) || (ascii > 127)) {
+            printf("%s", usage);
+            return;
+        }
+        chu_cfg->nkro.keymap[key] = ascii;
+    } else {
+        printf("%s", usage);
+        return;
+    }
+
+    report_nkro_keymap(chu_cfg->nkro.keymap);
+    config_changed();
+    disp_hid();
+}
+
 static void handle_tof(int argc, char *argv[])
 {
     const char *usage = "Usage: tof <offset> [pitch]\n"
@@ -481,6 +755,30 @@ static void handle_raw()
     printf("\n");
 }
 
+static void handle_trace(int argc, char *argv[])
+{
+    const char *usage = "Usage: trace <start|stop>\n"
+                        "Streams binary sensor frames on this port until stopped.\n";
+    if (argc != 1) {
+        printf(usage);
+        return;
+    }
+
+    const char *choices[] = {"start", "stop"};
+    int match = cli_match_prefix(choices, count_of(choices), argv[0]);
+    if (match == 0) {
+        printf("Trace started, %d bytes per frame.\n", (int)sizeof(trace_frame_t));
+        fflush(stdout);
+        trace_start();
+    } else if (match == 1) {
+        trace_stop();
+        printf("\nTrace stopped, sent: %lu, dropped: %lu.\n",
+               trace_sent(), trace_dropped());
+    } else {
+        printf(usage);
+    }
+}
+
 static void handle_save()
 {
     save_request(true);
@@ -489,6 +787,10 @@ static void handle_save()
 static void handle_factory_reset()
 {
     config_factory_reset();
+    report_nkro_keymap(chu_cfg->nkro.keymap);
+    profile_reset();
+    save_request(true); // config and profiles in one go
+    rgb_update_level();
     printf("Factory reset done.\n");
 }
 
@@ -563,46 +865,99 @@ static void handle_aime(int argc, char *argv[])
 
 static void handle_tweak(int argc, char *argv[])
 {
-    const char *usage = "Usage: tweak skip_split <on|off>\n";
-    if (argc < 1) {
+    const char *usage = "Usage: tweak skip_split <on|off>\n"
+                        "       tweak touch_irq <on|off>\n"
+                        "       tweak touch_mode <mpr121|soft|position>\n";
+    if (argc != 2) {
         printf("%s", usage);
         return;
     }
-    const char *options[] = { "skip_split" };
+    const char *options[] = { "skip_split", "touch_irq", "touch_mode" };
     int match = cli_match_prefix(options, count_of(options), argv[0]);
     if (match < 0) {
         printf("%s", usage);
         return;
     }
 
-    if (match == 0) {
-        if (argc != 2) {
+    if (match == 2) {
+        const char *modes[] = { "mpr121", "soft", "position" };
+        int mode = cli_match_prefix(modes, count_of(modes), argv[1]);
+        if (mode < 0) {
             printf("%s", usage);
             return;
         }
-        const char *on_off[] = { "off", "on" };
-        int on = cli_match_prefix(on_off, count_of(on_off), argv[1]);
-        if (on < 0) {
-            printf("%s", usage);
+        chu_cfg->tweak.touch_mode = mode;
+        config_changed();
+        disp_tweak();
+        return;
+    }
+
+    const char *on_off[] = { "off", "on" };
+    int on = cli_match_prefix(on_off, count_of(on_off), argv[1]);
+    if (on < 0) {
+        printf("%s", usage);
+        return;
+    }
+
+    if (match == 0) {
+        chu_cfg->tweak.skip_split_led = (on > 0);
+    } else if (match == 1) {
+#ifndef MPR121_IRQ_GPIO
+        if (on > 0) {
+            printf("Touch IRQ lines are not wired, needs a CHU_MOD_TOUCH_IRQ build.\n");
             return;
         }
-        chu_cfg->tweak.skip_split_led = (on > 0);
+#endif
+        chu_cfg->tweak.touch_irq = (on > 0);
     }
     config_changed();
+    disp_tweak();
+}
+
+static void disp_led_fps()
+{
+    rgb_stat_t stat;
+    rgb_stat(&stat);
+    printf("LED: host %lu fps, %lu merged\n", stat.host_frames, stat.host_merged);
+}
+
+static void handle_led(int argc, char *argv[])
+{
+    if (argc != 0) {
+        printf("Usage: led\n");
+        return;
+    }
+
+    rgb_stat_t stat;
+    rgb_stat(&stat);
+    printf("LED stats, last second:\n");
+    printf("  Host: %lu frames, %lu merged\n", stat.host_frames, stat.host_merged);
+    printf("  Sent: %lu frames, %lu keepalive, %lu skipped\n",
+           stat.sent, stat.keepalive, stat.skipped);
+    printf("  CPU: %lu us, Bus: %lu us\n", stat.cpu_us, stat.bus_us);
 }
 
 void commands_init()
 {
+    cli_fps_extra(disp_led_fps);
     cli_register("display", handle_display, "Display all config.");
     cli_register("level", handle_level, "Set LED brightness level.");
+    cli_register("style", handle_style, "Set lighting effect styles.");
+    cli_register("colorfix", handle_color_fix, "Set LED color correction.");
+    cli_register("led", handle_led, "Display LED output stats.");
     cli_register("stat", handle_stat, "Display or reset statistics.");
+    cli_register("latency", handle_latency, "Display or reset input latency.");
+    cli_register("perf", handle_perf, "Display or reset loop profiling.");
+    cli_register("profile", handle_profile, "Switch or rename config profiles.");
     cli_register("hid", handle_hid, "Set HID mode.");
+    cli_register("keymap", handle_keymap, "Set NKRO keymap.");
     cli_register("tof", handle_tof, "Set ToF config.");
     cli_register("ir", handle_ir, "Set IR config.");
     cli_register("filter", handle_filter, "Set pre-filter config.");
     cli_register("sense", handle_sense, "Set sensitivity config.");
     cli_register("debounce", handle_debounce, "Set debounce config.");
     cli_register("raw", handle_raw, "Show key raw readings.");
+    cli_register("trace", handle_trace, "Stream raw sensor frames.");
     cli_register("tweak", handle_tweak, "Tweak options.");
     cli_register("save", handle_save, "Save config to flash.");
     cli_register("factory", handle_factory_reset, "Reset everything to default.");
@@ -6,8 +6,13 @@
  * Runtime is something to share between files.
  */
 
+#include <string.h>
+
 #include "config.h"
 #include "save.h"
+#include "board_defs.h"
+#include "lights.h"
+#include "report.h"
 
 chu_cfg_t *chu_cfg;
 
@@ -49,6 +54,16 @@ static chu_cfg_t default_cfg = {
     },
     .tweak = {
         .skip_split_led = false,
+        .touch_irq = false,
+        .touch_mode = 0,
+    },
+    .nkro = {
+        .keymap = NKRO_KEYMAP,
+    },
+    .color_fix = {
+        .key = { 255, 255, 255 },
+        .gap = { 255, 255, 255 },
+        .tower = { 255, 255, 255 },
     },
 };
 
@@ -75,12 +90,35 @@ static void config_loaded()
             config_changed();
         }
     }
+    if (chu_cfg->tweak.touch_mode > 2) {
+        chu_cfg->tweak.touch_mode = default_cfg.tweak.touch_mode;
+        config_changed();
+    }
+    if (strnlen(chu_cfg->nkro.keymap, sizeof(chu_cfg->nkro.keymap)) !=
+        sizeof(chu_cfg->nkro.keymap) - 1) {
+        memcpy(chu_cfg->nkro.keymap, default_cfg.nkro.keymap, sizeof(chu_cfg->nkro.keymap));
+        config_changed();
+    }
+    static const uint8_t unset[sizeof(chu_cfg->color_fix)] = { 0 };
+    if (memcmp(&chu_cfg->color_fix, unset, sizeof(unset)) == 0) {
+        chu_cfg->color_fix = default_cfg.color_fix;
+        config_changed();
+    }
+    if ((chu_cfg->style.key >= LIGHTS_KEY_STYLE_NUM) ||
+        (chu_cfg->style.gap >= LIGHTS_GAP_STYLE_NUM) ||
+        (chu_cfg->style.tof >= LIGHTS_TOF_STYLE_NUM)) {
+        chu_cfg->style.key = default_cfg.style.key;
+        chu_cfg->style.gap = default_cfg.style.gap;
+        chu_cfg->style.tof = default_cfg.style.tof;
+        config_changed();
+    }
     if ((chu_cfg->sense.debounce_touch > 7) |
         (chu_cfg->sense.debounce_release > 7)) {
         chu_cfg->sense.debounce_touch = default_cfg.sense.debounce_touch;
         chu_cfg->sense.debounce_release = default_cfg.sense.debounce_release;
         config_changed();
     }
+    report_nkro_keymap(chu_cfg->nkro.keymap);
 }
 
 void config_changed()
@@ -91,7 +129,7 @@ void config_changed()
 void config_factory_reset()
 {
     *chu_cfg = default_cfg;
-    save_request(true);
+    config_changed();
 }
 
 void config_init()
@@ -9,6 +9,31 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Sections that also live in profiles, layout as they always were */
+typedef struct {
+    uint8_t offset;
+    uint8_t pitch;
+} chu_tof_cfg_t;
+
+typedef struct {
+    uint8_t filter; // FFI[6..7], SFI[4..5], ESI[0..3]
+    int8_t global;
+    uint8_t debounce_touch;
+    uint8_t debounce_release;        
+    int8_t keys[32];
+} chu_sense_cfg_t;
+
+typedef struct {
+    uint8_t joy : 4;
+    uint8_t nkro : 4;
+} chu_hid_cfg_t;
+
+typedef struct {
+    bool enabled;
+    uint16_t base[6];
+    uint8_t trigger[6];
+} chu_ir_cfg_t;
+
 typedef struct __attribute__((packed)) {
     struct {
         uint32_t key_on_upper;
@@ -23,34 +48,28 @@ typedef struct __attribute__((packed)) {
         uint8_t tof;
         uint8_t level;
     } style;
-    struct {
-        uint8_t offset;
-        uint8_t pitch;
-    } tof;
-    struct {
-        uint8_t filter; // FFI[6..7], SFI[4..5], ESI[0..3]
-        int8_t global;
-        uint8_t debounce_touch;
-        uint8_t debounce_release;        
-        int8_t keys[32];
-    } sense;
-    struct {
-        uint8_t joy : 4;
-        uint8_t nkro : 4;
-    } hid;
+    chu_tof_cfg_t tof;
+    chu_sense_cfg_t sense;
+    chu_hid_cfg_t hid;
     struct {
         uint8_t mode : 4;
         uint8_t virtual_aic : 4;
     } aime;
-    struct {
-        bool enabled;
-        uint16_t base[6];
-        uint8_t trigger[6];
-    } ir;
+    chu_ir_cfg_t ir;
     struct {
         bool skip_split_led;
-        uint8_t reserved[7];
+        bool touch_irq;
+        uint8_t touch_mode; // 0: MPR121, 1: software, 2: software + positions
+        uint8_t reserved[5];
     } tweak;
+    struct {
+        char keymap[41 + 1]; // 32 keys, 6 air keys, 3 aux, 1 terminator
+    } nkro;
+    struct { // r, g, b scale, 255 is 100%
+        uint8_t key[3];
+        uint8_t gap[3];
+        uint8_t tower[3];
+    } color_fix;
 } chu_cfg_t;
 
 typedef struct {
@@ -63,6 +82,6 @@ extern chu_runtime_t chu_runtime;
 
 void config_init();
 void config_changed(); // Notify the config has changed
-void config_factory_reset(); // Reset the config to factory default
+void config_factory_reset(); // Reset the config to factory default, saved later
 
 #endif
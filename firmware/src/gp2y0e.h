@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include "hardware/i2c.h"
+#include "i2c_scan.h"
 
 #define GP2Y0E_DEF_ADDR 0x40
 
@@ -41,6 +42,11 @@ static inline uint8_t gp2y0e_dist_mm(i2c_inst_t *port)
     return data * 10 / 4;
 }
 
+static inline uint16_t gp2y0e_dist16_decode(const uint8_t data[2])
+{
+    return ((data[0] << 4) | data[1]) * 10 / 64;
+}
+
 static inline uint16_t gp2y0e_dist16_mm(i2c_inst_t *port)
 {
     uint8_t cmd[] = {0x5e};
@@ -48,7 +54,13 @@ static inline uint16_t gp2y0e_dist16_mm(i2c_inst_t *port)
     uint8_t data[2];
     i2c_read_blocking_until(port, GP2Y0E_DEF_ADDR, data, 2, false, time_us_64() + 1000);
 
-    return ((data[0] << 4) | data[1]) * 10 / 64;
+    return gp2y0e_dist16_decode(data);
+}
+
+/* Queued read, decode data with gp2y0e_dist16_decode() in the callback */
+static inline bool gp2y0e_scan_dist16(uint8_t data[2], i2c_txn_cb cb, uint32_t arg)
+{
+    return i2c_scan_read(GP2Y0E_DEF_ADDR, 0x5e, data, 2, cb, arg);
 }
 
 #endif
\ No newline at end of file
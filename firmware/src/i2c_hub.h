@@ -9,6 +9,7 @@
 
 #include "hardware/i2c.h"
 #include "board_defs.h"
+#include "i2c_scan.h"
 
 #define I2C_HUB_ADDR 0x70
 static inline void i2c_hub_init()
@@ -30,4 +31,9 @@ static inline void i2c_select(i2c_inst_t *i2c_port, uint8_t chn)
     i2c_write_blocking_until(i2c_port, I2C_HUB_ADDR, &chn, 1, false, time_us_64() + 1000);
 }
 
+static inline bool i2c_scan_select(uint8_t chn)
+{
+    return i2c_scan_write(I2C_HUB_ADDR, &chn, 1, NULL, 0);
+}
+
 #endif
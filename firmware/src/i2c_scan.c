@@ -0,0 +1,214 @@
+/*
+ * Interrupt Driven I2C Scan Engine
+ * WHowe <github.com/whowechina>
+ *
+ * A small queue of I2C transactions executed by the I2C IRQ, so core 0
+ * doesn't have to busy-wait on every byte. Callbacks run in IRQ context.
+ * The queue is here, the bus work is up to a backend.
+ */
+
+#include "i2c_scan.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "hardware/timer.h"
+
+#define IO_TIMEOUT_US 1000
+#define TXN_OVERHEAD_US 5 // IRQ entry and FIFO turnaround
+#define QUEUE_SIZE 32
+
+static const i2c_scan_backend_t *backend;
+
+static i2c_txn_t queue[QUEUE_SIZE];
+static volatile unsigned head;
+static volatile unsigned tail;
+static unsigned chain_pos;
+static volatile bool in_callback;
+
+static volatile bool busy;
+static uint32_t txn_start;
+
+static uint32_t aborted;
+static uint32_t dropped;
+
+#define QUEUE_NEXT(x) (((x) + 1) % QUEUE_SIZE)
+
+static void start_txn()
+{
+    txn_start = time_us_32();
+    backend->start(&queue[head]);
+}
+
+void i2c_scan_done(bool ok)
+{
+    i2c_txn_t txn = queue[head];
+    head = QUEUE_NEXT(head);
+
+    chain_pos = 0;
+    if (txn.cb) {
+        in_callback = true;
+        txn.cb(&txn, ok);
+        in_callback = false;
+    }
+
+    if (head != tail) {
+        start_txn();
+    } else {
+        busy = false;
+    }
+}
+
+void i2c_scan_use(const i2c_scan_backend_t *scan_backend)
+{
+    backend = scan_backend;
+    head = tail = 0;
+    chain_pos = 0;
+    in_callback = false;
+    busy = false;
+}
+
+bool i2c_scan_add(const i2c_txn_t *txn)
+{
+    if (busy || (QUEUE_NEXT(tail) == head)) {
+        return false;
+    }
+    queue[tail] = *txn;
+    tail = QUEUE_NEXT(tail);
+    return true;
+}
+
+bool i2c_scan_chain(const i2c_txn_t *txn)
+{
+    /* from anywhere else it would reshuffle the queue under the IRQ */
+    if (!in_callback || (QUEUE_NEXT(tail) == head)) {
+        return false;
+    }
+
+    /* keep chained transactions in the order they're chained */
+    unsigned pos = (head + chain_pos) % QUEUE_SIZE;
+    for (unsigned i = tail; i != pos; i = (i + QUEUE_SIZE - 1) % QUEUE_SIZE) {
+        queue[i] = queue[(i + QUEUE_SIZE - 1) % QUEUE_SIZE];
+    }
+    queue[pos] = *txn;
+    tail = QUEUE_NEXT(tail);
+    chain_pos++;
+    return true;
+}
+
+bool i2c_scan_write(uint8_t addr, const uint8_t *data, uint8_t len,
+                    i2c_txn_cb cb, uint32_t arg)
+{
+    i2c_txn_t txn = { .addr = addr, .cb = cb, .arg = arg };
+    if (len > sizeof(txn.wbuf)) {
+        return false;
+    }
+    memcpy(txn.wbuf, data, len);
+    txn.wlen = len;
+    return in_callback ? i2c_scan_chain(&txn) : i2c_scan_add(&txn);
+}
+
+bool i2c_scan_read(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len,
+                   i2c_txn_cb cb, uint32_t arg)
+{
+    i2c_txn_t txn = {
+        .addr = addr,
+        .wlen = 1,
+        .wbuf = { reg },
+        .rlen = len,
+        .rbuf = buf,
+        .cb = cb,
+        .arg = arg,
+    };
+    return in_callback ? i2c_scan_chain(&txn) : i2c_scan_add(&txn);
+}
+
+/* 9 clocks a byte, address bytes included, plus start and stop */
+uint32_t i2c_scan_bus_us(uint32_t baudrate)
+{
+    uint32_t us = 0;
+    for (unsigned i = head; i != tail; i = QUEUE_NEXT(i)) {
+        const i2c_txn_t *txn = &queue[i];
+        uint32_t bytes = 1 + txn->wlen + (txn->rlen ? 1 + txn->rlen : 0);
+        us += (bytes * 9 + 2) * 1000000 / baudrate + TXN_OVERHEAD_US;
+    }
+    return us;
+}
+
+bool i2c_scan_busy()
+{
+    return busy;
+}
+
+/* Kill the current transaction, the rest of the queue goes on unless dropped */
+static void abort_txn(bool drop_all)
+{
+    backend->abort();
+
+    aborted++;
+    if (drop_all) {
+        /* the current one is counted as aborted, not dropped */
+        dropped += (tail + QUEUE_SIZE - head) % QUEUE_SIZE - 1;
+        head = tail;
+        busy = false;
+        return;
+    }
+
+    i2c_scan_done(false);
+}
+
+/* Also the I/O timeout check for when nobody waits in i2c_scan_sync() */
+void i2c_scan_start()
+{
+    backend->irq_enable(false);
+    if (busy) {
+        if (time_us_32() - txn_start >= IO_TIMEOUT_US) {
+            abort_txn(false);
+        }
+    } else if (head != tail) {
+        busy = true;
+        start_txn();
+    }
+    backend->irq_enable(true);
+}
+
+/* Resetting the block under a live IRQ would have it feed a stale
+   transaction with whatever the blocking calls put on the bus */
+void i2c_scan_bus_init(uint32_t baudrate)
+{
+    backend->irq_enable(false);
+    if (busy) {
+        abort_txn(true);
+    }
+    backend->bus_init(baudrate);
+    backend->irq_enable(true);
+}
+
+void i2c_scan_stat(uint32_t *abort_count, uint32_t *drop_count)
+{
+    *abort_count = aborted;
+    *drop_count = dropped;
+}
+
+bool i2c_scan_sync(uint32_t timeout_us)
+{
+    uint32_t start = time_us_32();
+
+    while (busy) {
+        uint32_t now = time_us_32();
+        bool expired = (now - start >= timeout_us);
+
+        backend->irq_enable(false);
+        if (busy && (expired || (now - txn_start >= IO_TIMEOUT_US))) {
+            abort_txn(expired);
+        }
+        backend->irq_enable(true);
+
+        if (expired) {
+            return false;
+        }
+    }
+
+    return true;
+}
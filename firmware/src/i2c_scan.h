@@ -0,0 +1,77 @@
+/*
+ * Interrupt Driven I2C Scan Engine
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef I2C_SCAN_H
+#define I2C_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hardware/i2c.h"
+
+typedef struct i2c_txn i2c_txn_t;
+typedef void (*i2c_txn_cb)(const i2c_txn_t *txn, bool ok);
+
+/* write wlen bytes, then (repeated start) read rlen bytes into rbuf */
+struct i2c_txn {
+    uint8_t addr;
+    uint8_t wlen;
+    uint8_t rlen;
+    uint8_t wbuf[4];
+    uint8_t *rbuf;
+    i2c_txn_cb cb;
+    uint32_t arg;
+};
+
+/* RP2040 I2C block as the backend, see i2c_scan_hw.c. The IRQ goes on
+   with the first i2c_scan_bus_init(). */
+void i2c_scan_init(i2c_inst_t *port);
+
+/* What actually moves the bytes. It runs one transaction at a time and
+   reports its end with i2c_scan_done(), normally from its IRQ. */
+typedef struct {
+    void (*start)(const i2c_txn_t *txn);
+    void (*abort)();               // kill the current one, no done call
+    void (*irq_enable)(bool on);   // keeps done calls out while off
+    void (*bus_init)(uint32_t baudrate); // (re)init the bus, IRQ is off
+} i2c_scan_backend_t;
+
+void i2c_scan_use(const i2c_scan_backend_t *backend);
+
+/* The port belongs to the scan engine, blocking I2C users bring the bus
+   up (again) through here. Anything queued is dropped. */
+void i2c_scan_bus_init(uint32_t baudrate);
+/* Only from the backend, the current transaction is over */
+void i2c_scan_done(bool ok);
+
+/* Queue up transactions before i2c_scan_start(), false while it runs */
+bool i2c_scan_add(const i2c_txn_t *txn);
+/* Only from a callback: run txn right after the current one, false
+   anywhere else */
+bool i2c_scan_chain(const i2c_txn_t *txn);
+
+/* Chained from inside a callback, added otherwise */
+bool i2c_scan_write(uint8_t addr, const uint8_t *data, uint8_t len,
+                    i2c_txn_cb cb, uint32_t arg);
+bool i2c_scan_read(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len,
+                   i2c_txn_cb cb, uint32_t arg);
+
+/* Starts the queue, or if it's still running from an earlier start,
+   aborts a transaction stuck for longer than the I/O timeout */
+void i2c_scan_start();
+bool i2c_scan_busy();
+
+/* Bus time of what's queued, before i2c_scan_start(). Chained ones
+   aren't known yet and aren't in it. */
+uint32_t i2c_scan_bus_us(uint32_t baudrate);
+
+/* Wait until the queue drains, anything left after timeout is dropped.
+   Bus is idle on return, so blocking I2C calls are safe afterwards. */
+bool i2c_scan_sync(uint32_t timeout_us);
+
+/* transactions killed by timeout, and dropped from the queue unstarted */
+void i2c_scan_stat(uint32_t *abort_count, uint32_t *drop_count);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * I2C Scan Engine Backend for the RP2040 I2C Block
+ * WHowe <github.com/whowechina>
+ *
+ * Feeds the TX FIFO and drains the RX FIFO from the I2C IRQ.
+ */
+
+#include "i2c_scan.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+
+#define FIFO_DEPTH 16
+
+static i2c_inst_t *port;
+static unsigned irq_num;
+
+static const i2c_txn_t *txn;
+static bool failed;
+static unsigned cmd_pos;
+static unsigned rx_pos;
+
+static void fill_tx()
+{
+    i2c_hw_t *hw = i2c_get_hw(port);
+    unsigned total = txn->wlen + txn->rlen;
+
+    while ((cmd_pos < total) && (hw->txflr < FIFO_DEPTH)) {
+        uint32_t cmd;
+        if (cmd_pos < txn->wlen) {
+            cmd = txn->wbuf[cmd_pos];
+        } else {
+            /* don't ask for more than the rx fifo can hold */
+            if (cmd_pos - txn->wlen - rx_pos >= FIFO_DEPTH) {
+                break;
+            }
+            cmd = I2C_IC_DATA_CMD_CMD_BITS;
+            if ((cmd_pos == txn->wlen) && (txn->wlen > 0)) {
+                cmd |= I2C_IC_DATA_CMD_RESTART_BITS;
+            }
+        }
+        if (cmd_pos == total - 1) {
+            cmd |= I2C_IC_DATA_CMD_STOP_BITS;
+        }
+        hw->data_cmd = cmd;
+        cmd_pos++;
+    }
+
+    if (cmd_pos >= total) {
+        hw->intr_mask &= ~I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+    }
+}
+
+static void hw_start(const i2c_txn_t *next)
+{
+    i2c_hw_t *hw = i2c_get_hw(port);
+
+    hw->enable = 0;
+    hw->tar = next->addr;
+    hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+
+    txn = next;
+    failed = false;
+    cmd_pos = 0;
+    rx_pos = 0;
+
+    hw->intr_mask = I2C_IC_INTR_MASK_M_RX_FULL_BITS |
+                    I2C_IC_INTR_MASK_M_TX_EMPTY_BITS |
+                    I2C_IC_INTR_MASK_M_TX_ABRT_BITS |
+                    I2C_IC_INTR_MASK_M_STOP_DET_BITS;
+    fill_tx();
+}
+
+static void hw_abort()
+{
+    i2c_hw_t *hw = i2c_get_hw(port);
+
+    hw->intr_mask = 0;
+    hw->enable |= I2C_IC_ENABLE_ABORT_BITS;
+    uint32_t start = time_us_32();
+    while ((hw->enable & I2C_IC_ENABLE_ABORT_BITS) &&
+           (time_us_32() - start < 100)) {
+        tight_loop_contents();
+    }
+    (void)hw->clr_intr;
+    hw->enable = 0;
+}
+
+static void hw_irq_enable(bool on)
+{
+    irq_set_enabled(irq_num, on);
+}
+
+static void i2c_scan_irq()
+{
+    i2c_hw_t *hw = i2c_get_hw(port);
+    uint32_t stat = hw->intr_stat;
+
+    if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        (void)hw->clr_tx_abrt;
+        failed = true;
+        hw->intr_mask &= ~I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+    }
+
+    if (stat & I2C_IC_INTR_STAT_R_RX_FULL_BITS) {
+        while (hw->rxflr > 0) {
+            uint8_t data = hw->data_cmd;
+            if (rx_pos < txn->rlen) {
+                txn->rbuf[rx_pos] = data;
+            }
+            rx_pos++;
+        }
+    }
+
+    if ((stat & I2C_IC_INTR_STAT_R_TX_EMPTY_BITS) && !failed) {
+        fill_tx();
+    }
+
+    if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        (void)hw->clr_stop_det;
+        bool ok = !failed && (rx_pos == txn->rlen);
+        /* the next one, if any, is started from in there */
+        hw->intr_mask = 0;
+        i2c_scan_done(ok);
+    }
+}
+
+/* i2c_init() resets the block, the interrupt mask comes back as 0x8FF */
+static void hw_bus_init(uint32_t baudrate)
+{
+    i2c_init(port, baudrate);
+
+    i2c_hw_t *hw = i2c_get_hw(port);
+    hw->intr_mask = 0;
+    hw->rx_tl = 0;
+    hw->tx_tl = 0;
+}
+
+static const i2c_scan_backend_t hw_backend = {
+    .start = hw_start,
+    .abort = hw_abort,
+    .irq_enable = hw_irq_enable,
+    .bus_init = hw_bus_init,
+};
+
+void i2c_scan_init(i2c_inst_t *i2c_port)
+{
+    port = i2c_port;
+    irq_num = I2C0_IRQ + i2c_hw_index(port);
+    irq_set_enabled(irq_num, false);
+
+    i2c_scan_use(&hw_backend);
+    irq_set_exclusive_handler(irq_num, i2c_scan_irq);
+}
@@ -0,0 +1,140 @@
+/*
+ * Input Latency Statistics
+ * WHowe <github.com/whowechina>
+ *
+ * Timestamps one touch at a time along the path from MPR121 to USB.
+ * Hardware independent on purpose, callers provide the time.
+ */
+
+#include "latency.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+static uint32_t points[LATENCY_POINT_NUM];
+static uint8_t marked;
+static bool tracing = false;
+
+static uint16_t ring[LATENCY_STAGE_NUM][LATENCY_RING_SIZE];
+static unsigned ring_pos = 0;
+static unsigned ring_count = 0;
+
+static uint32_t hist[LATENCY_BUCKET_NUM];
+
+void latency_begin(uint32_t sampled, uint32_t now)
+{
+    if (tracing && (now - points[LATENCY_UPDATED] < LATENCY_EXPIRE_US)) {
+        return; // still tracing an older one
+    }
+    tracing = true;
+    points[LATENCY_SAMPLED] = sampled;
+    points[LATENCY_UPDATED] = now;
+    marked = (1 << LATENCY_SAMPLED) | (1 << LATENCY_UPDATED);
+}
+
+void latency_mark(latency_point_t point, uint32_t now)
+{
+    if (!tracing || (marked & (1 << point))) {
+        return;
+    }
+    points[point] = now;
+    marked |= 1 << point;
+}
+
+static inline uint16_t clamp16(uint32_t us)
+{
+    return us > 0xffff ? 0xffff : us;
+}
+
+void latency_end(uint32_t now)
+{
+    if (!tracing) {
+        return;
+    }
+    tracing = false;
+
+    if (!(marked & (1 << LATENCY_BUILT))) {
+        points[LATENCY_BUILT] = now;
+    }
+    points[LATENCY_SENT] = now;
+
+    uint32_t total = now - points[LATENCY_SAMPLED];
+    ring[LATENCY_STAGE_SCAN][ring_pos] = clamp16(points[LATENCY_UPDATED] - points[LATENCY_SAMPLED]);
+    ring[LATENCY_STAGE_BUILD][ring_pos] = clamp16(points[LATENCY_BUILT] - points[LATENCY_UPDATED]);
+    ring[LATENCY_STAGE_USB][ring_pos] = clamp16(now - points[LATENCY_BUILT]);
+    ring[LATENCY_STAGE_TOTAL][ring_pos] = clamp16(total);
+
+    ring_pos = (ring_pos + 1) % LATENCY_RING_SIZE;
+    if (ring_count < LATENCY_RING_SIZE) {
+        ring_count++;
+    }
+
+    unsigned bucket = total / LATENCY_BUCKET_US;
+    if (bucket >= LATENCY_BUCKET_NUM) {
+        bucket = LATENCY_BUCKET_NUM - 1;
+    }
+    hist[bucket]++;
+}
+
+/* No report is going out for the touch being traced, drop it */
+void latency_cancel()
+{
+    tracing = false;
+}
+
+const char *latency_stage_name(latency_stage_t stage)
+{
+    static const char *names[] = { "scan", "build", "usb", "total" };
+    if (stage >= LATENCY_STAGE_NUM) {
+        return "";
+    }
+    return names[stage];
+}
+
+/* Not for the hot path, it sorts a copy of the ring */
+void latency_stat(latency_stage_t stage, latency_stat_t *stat)
+{
+    memset(stat, 0, sizeof(*stat));
+    if ((stage >= LATENCY_STAGE_NUM) || (ring_count == 0)) {
+        return;
+    }
+
+    uint16_t sorted[LATENCY_RING_SIZE];
+    unsigned num = ring_count;
+    uint32_t sum = 0;
+
+    for (unsigned i = 0; i < num; i++) {
+        uint16_t val = ring[stage][i];
+        unsigned j = i;
+        while ((j > 0) && (sorted[j - 1] > val)) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = val;
+        sum += val;
+    }
+
+    stat->count = num;
+    stat->min = sorted[0];
+    stat->max = sorted[num - 1];
+    stat->avg = sum / num;
+    stat->p99 = sorted[(num - 1) * 99 / 100];
+}
+
+uint32_t latency_hist_count(unsigned bucket)
+{
+    if (bucket >= LATENCY_BUCKET_NUM) {
+        return 0;
+    }
+    return hist[bucket];
+}
+
+void latency_reset()
+{
+    tracing = false;
+    memset(ring, 0, sizeof(ring));
+    ring_pos = 0;
+    ring_count = 0;
+    memset(hist, 0, sizeof(hist));
+}
@@ -0,0 +1,53 @@
+/*
+ * Input Latency Statistics
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LATENCY_BUCKET_US 100
+#define LATENCY_BUCKET_NUM 20 // last one collects everything beyond
+#define LATENCY_RING_SIZE 256
+#define LATENCY_EXPIRE_US 100000 // a touch no report went out for
+
+typedef enum {
+    LATENCY_SAMPLED = 0, // MPR121 touch status read back
+    LATENCY_UPDATED,     // slider_update() picked it up
+    LATENCY_BUILT,       // HID report generated
+    LATENCY_SENT,        // tud_hid_report() accepted it
+    LATENCY_POINT_NUM
+} latency_point_t;
+
+/* Stages are intervals between points, the last one is the whole path */
+typedef enum {
+    LATENCY_STAGE_SCAN = 0,
+    LATENCY_STAGE_BUILD,
+    LATENCY_STAGE_USB,
+    LATENCY_STAGE_TOTAL,
+    LATENCY_STAGE_NUM
+} latency_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t avg;
+    uint32_t p99;
+    uint32_t max;
+} latency_stat_t;
+
+/* Hot path, times are from time_us_32() */
+void latency_begin(uint32_t sampled, uint32_t now);
+void latency_mark(latency_point_t point, uint32_t now);
+void latency_end(uint32_t now);
+void latency_cancel();
+
+const char *latency_stage_name(latency_stage_t stage);
+void latency_stat(latency_stage_t stage, latency_stat_t *stat);
+uint32_t latency_hist_count(unsigned bucket);
+void latency_reset();
+
+#endif
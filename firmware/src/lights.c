@@ -0,0 +1,246 @@
+/*
+ * Lighting Effects
+ * WHowe <github.com/whowechina>
+ *
+ * Local lighting when the host is not driving the LEDs.
+ * Fixed point all the way, every LED is touched once per frame.
+ */
+
+#include "lights.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "rgb.h"
+
+#define KEY_NUM 16
+#define GAP_NUM 15
+
+#define MAX_STEP_MS 50        // don't jump too far after a stall
+#define FADE_MS 300           // key trail after release
+#define BREATH_MS 4000        // one full breath
+#define RIPPLE_NUM 4
+#define RIPPLE_LIFE_MS 600
+#define RIPPLE_SPEED 4        // Q8 keys per ms, about 16 keys/s
+
+#define BREATH_STEPS 64
+
+static uint32_t gap_palette[GAP_NUM];
+static uint16_t breath_curve[BREATH_STEPS]; // Q8, 16..256
+
+static uint16_t key_fade[KEY_NUM]; // Q16, 0 is off
+static uint16_t last_pairs;        // touched key pairs last frame
+
+static struct {
+    int16_t center; // Q8 key position
+    uint16_t age;   // ms
+} ripples[RIPPLE_NUM];
+static unsigned ripple_next;
+
+static uint32_t last_ms;
+static uint32_t elapsed_ms;
+
+void lights_init()
+{
+    for (int i = 0; i < GAP_NUM; i++) {
+        gap_palette[i] = rgb32_from_hsv(i * 573 / 15, 255, 16);
+    }
+
+    /* smoothstep up and down */
+    for (int i = 0; i < BREATH_STEPS; i++) {
+        uint32_t t = (i < BREATH_STEPS / 2) ? i : BREATH_STEPS - 1 - i;
+        t = t * 256 / (BREATH_STEPS / 2 - 1);
+        uint32_t s = t * t * (768 - 2 * t) / 65536;
+        breath_curve[i] = 16 + s * 240 / 256;
+    }
+
+    memset(key_fade, 0, sizeof(key_fade));
+    memset(ripples, 0, sizeof(ripples));
+    for (int i = 0; i < RIPPLE_NUM; i++) {
+        ripples[i].age = RIPPLE_LIFE_MS;
+    }
+}
+
+/* each channel times level / 256 */
+static inline uint32_t scale(uint32_t color, uint32_t level)
+{
+    return ((((color & 0xff00ff) * level) >> 8) & 0xff00ff) |
+           ((((color & 0x00ff00) * level) >> 8) & 0x00ff00);
+}
+
+static inline uint32_t blend(uint32_t from, uint32_t to, uint32_t level)
+{
+    return scale(to, level) + scale(from, 256 - level);
+}
+
+static inline uint32_t cfg_color(uint32_t rgb)
+{
+    return rgb32((rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff, false);
+}
+
+static inline unsigned key_led(int key)
+{
+    return 30 - key * 2;
+}
+
+static inline uint32_t breath_level()
+{
+    return breath_curve[(elapsed_ms % BREATH_MS) * BREATH_STEPS / BREATH_MS];
+}
+
+static uint32_t pair_color(uint16_t pairs, int key)
+{
+    bool lower = pairs & (1 << (key * 2));
+    bool upper = pairs & (1 << (key * 2 + 1));
+    if (lower && upper) {
+        return cfg_color(chu_cfg->colors.key_on_both);
+    } else if (upper) {
+        return cfg_color(chu_cfg->colors.key_on_upper);
+    }
+    return cfg_color(chu_cfg->colors.key_on_lower);
+}
+
+static void keys_classic(uint32_t touched)
+{
+    for (int i = 0; i < KEY_NUM; i++) {
+        bool r = touched & (1 << (i * 2));
+        bool g = touched & (1 << (i * 2 + 1));
+        rgb_set_color(key_led(i), rgb32(r ? 80 : 0, g ? 80 : 0, 0, false));
+    }
+}
+
+static void keys_fade(uint32_t touched, uint32_t step_ms)
+{
+    static uint32_t colors[KEY_NUM];
+    uint32_t off = cfg_color(chu_cfg->colors.key_off);
+    uint32_t fade = step_ms * (65535 / FADE_MS);
+
+    for (int i = 0; i < KEY_NUM; i++) {
+        if (touched & (3 << (i * 2))) {
+            colors[i] = pair_color(touched, i);
+            key_fade[i] = 65535;
+        } else {
+            key_fade[i] = (key_fade[i] > fade) ? key_fade[i] - fade : 0;
+        }
+        uint32_t level = (key_fade[i] + 255) >> 8;
+        rgb_set_color(key_led(i), blend(off, colors[i], level));
+    }
+}
+
+static void keys_ripple(uint32_t touched, uint32_t step_ms)
+{
+    /* new ripple for every key pair just touched */
+    uint16_t pairs = 0;
+    for (int i = 0; i < KEY_NUM; i++) {
+        pairs |= (touched & (3 << (i * 2))) ? (1 << i) : 0;
+    }
+    uint16_t fresh = pairs & ~last_pairs;
+    last_pairs = pairs;
+
+    for (int i = 0; i < KEY_NUM; i++) {
+        if (fresh & (1 << i)) {
+            ripples[ripple_next].center = i * 256 + 128;
+            ripples[ripple_next].age = 0;
+            ripple_next = (ripple_next + 1) % RIPPLE_NUM;
+        }
+    }
+    for (int r = 0; r < RIPPLE_NUM; r++) {
+        uint32_t age = ripples[r].age + step_ms;
+        ripples[r].age = (age > RIPPLE_LIFE_MS) ? RIPPLE_LIFE_MS : age;
+    }
+
+    uint32_t off = cfg_color(chu_cfg->colors.key_off);
+    uint32_t wave = cfg_color(chu_cfg->colors.key_on_both);
+
+    for (int i = 0; i < KEY_NUM; i++) {
+        int pos = i * 256 + 128;
+        uint32_t level = 0;
+        for (int r = 0; r < RIPPLE_NUM; r++) {
+            int radius = ripples[r].age * RIPPLE_SPEED;
+            int dist = abs(abs(pos - ripples[r].center) - radius);
+            if ((dist < 256) && (ripples[r].age < RIPPLE_LIFE_MS)) {
+                uint32_t v = (256 - dist) * (RIPPLE_LIFE_MS - ripples[r].age) /
+                             RIPPLE_LIFE_MS;
+                level = (v > level) ? v : level;
+            }
+        }
+
+        uint32_t color = blend(off, wave, level);
+        if (pairs & (1 << i)) {
+            color = pair_color(touched, i);
+        }
+        rgb_set_color(key_led(i), color);
+    }
+}
+
+static void draw_keys(uint32_t touched, uint32_t step_ms)
+{
+    switch (chu_cfg->style.key) {
+        case 1:
+            keys_fade(touched, step_ms);
+            break;
+        case 2:
+            keys_ripple(touched, step_ms);
+            break;
+        default:
+            keys_classic(touched);
+            break;
+    }
+}
+
+static void draw_gaps()
+{
+    uint32_t gap = cfg_color(chu_cfg->colors.gap);
+    uint32_t level = breath_level();
+
+    for (int i = 0; i < GAP_NUM; i++) {
+        switch (chu_cfg->style.gap) {
+            case 1:
+                rgb_gap_color(i, scale(gap, level));
+                break;
+            case 2:
+                rgb_gap_color(i, gap);
+                break;
+            default:
+                rgb_gap_color(i, gap_palette[i]);
+                break;
+        }
+    }
+}
+
+static void draw_tof(const lights_input_t *input)
+{
+    const uint32_t colors[] = {0x000000, 0x0000ff, 0xff0000, 0xffff00,
+                               0x00ff00, 0x00ffff, 0xffffff};
+    uint32_t idle = scale(colors[1], breath_level());
+
+    for (int i = 0; i < input->tof_num; i++) {
+        unsigned d = input->tof[i];
+        if (d >= sizeof(colors) / sizeof(colors[0])) {
+            d = sizeof(colors) / sizeof(colors[0]) - 1;
+        }
+        if ((d == 0) && (chu_cfg->style.tof == 1)) {
+            rgb_set_color(31 + i, idle);
+        } else {
+            rgb_set_color(31 + i, colors[d]);
+        }
+    }
+}
+
+void lights_update(uint32_t now_us, const lights_input_t *input)
+{
+    uint32_t now_ms = now_us / 1000;
+    uint32_t step_ms = now_ms - last_ms;
+    if (step_ms > MAX_STEP_MS) {
+        step_ms = MAX_STEP_MS;
+    }
+    last_ms = now_ms;
+    elapsed_ms += step_ms;
+
+    draw_tof(input);
+    draw_gaps();
+    draw_keys(input->touched, step_ms);
+}
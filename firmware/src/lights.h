@@ -0,0 +1,27 @@
+/*
+ * Lighting Effects
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LIGHTS_KEY_STYLE_NUM 3 // classic, fade, ripple
+#define LIGHTS_GAP_STYLE_NUM 3 // rainbow, breath, solid
+#define LIGHTS_TOF_STYLE_NUM 2 // distance, distance + idle breath
+
+typedef struct {
+    uint32_t touched; // bit n is slider key n
+    uint8_t tof_num;
+    uint8_t tof[6];   // distance zone, 0 is nothing there
+} lights_input_t;
+
+void lights_init();
+
+/* Draws a frame for the styles in chu_cfg->style, fixed cost per call */
+void lights_update(uint32_t now_us, const lights_input_t *input);
+
+#endif
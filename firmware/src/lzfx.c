@@ -7,6 +7,7 @@
 
 
 #include <stdlib.h>
+#include <string.h>
 #include "lzfx.h"
 
 typedef unsigned char u8;
@@ -63,6 +64,34 @@ static int lzfx_getsize(const void *ibuf, unsigned int ilen, unsigned int *olen)
     return 0;
 }
 
+/* Same result as a forward byte by byte copy, which is what a backref
+   means when it overlaps itself, but done in bulk. */
+static inline void copy_backref(u8 *op, const u8 *ref, unsigned int len)
+{
+    unsigned int dist = op - ref;
+
+    if (dist >= len) {
+        memcpy(op, ref, len);
+        return;
+    }
+
+    if (dist == 1) {
+        memset(op, *ref, len);
+        return;
+    }
+
+    /* repeating pattern, every round doubles what's available to copy */
+    while (len > 0) {
+        unsigned int n = op - ref;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(op, ref, n);
+        op += n;
+        len -= n;
+    }
+}
+
 /* Decompressor */
 int lzfx_decompress(const void *ibuf, unsigned int ilen,
                     void *obuf, unsigned int *olen)
@@ -110,9 +139,9 @@ int lzfx_decompress(const void *ibuf, unsigned int ilen,
             if (fx_expect_false(ip + ctrl > in_end))
                 return LZFX_ECORRUPT;
 
-            do
-                *op++ = *ip++;
-            while (--ctrl);
+            memcpy(op, ip, ctrl);
+            op += ctrl;
+            ip += ctrl;
 
             /*  Format #1 [LLLooooo oooooooo]: backref of length L+1+2
                               ^^^^^ ^^^^^^^^
@@ -150,9 +179,8 @@ int lzfx_decompress(const void *ibuf, unsigned int ilen,
             if (fx_expect_false(ref < (u8 *)obuf))
                 return LZFX_ECORRUPT;
 
-            do
-                *op++ = *ref++;
-            while (--len);
+            copy_backref(op, ref, len);
+            op += len;
         }
 
     } while (ip < in_end);
@@ -5,6 +5,9 @@
  * <https://github.com/CrazyRedMachine/RedBoard/blob/main/io_dll/src/utils/hid_impl.c>
  */
 
+#ifndef LZFX_H
+#define LZFX_H
+
 #define LZFX_ESIZE      -1      /* Output buffer too small */
 #define LZFX_ECORRUPT   -2      /* Invalid data for decompression */
 #define LZFX_EARGS      -3      /* Arguments invalid (NULL) */
@@ -15,4 +18,6 @@
 #define fx_expect_true(expr)   (expr)
 
 int lzfx_decompress(const void* ibuf, unsigned int ilen,
-                          void* obuf, unsigned int *olen);
\ No newline at end of file
+                          void* obuf, unsigned int *olen);
+
+#endif
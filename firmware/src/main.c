@@ -32,115 +32,87 @@
 #include "commands.h"
 
 #include "i2c_hub.h"
+#include "i2c_scan.h"
 #include "slider.h"
 #include "air.h"
 #include "rgb.h"
+#include "lights.h"
+#include "perf.h"
 #include "button.h"
-#include "lzfx.h"
+#include "latency.h"
+#include "trace.h"
+#include "report.h"
+#include "profile.h"
 
-struct __attribute__((packed)) {
-    uint16_t buttons; // 16 buttons; see JoystickButtons_t for bit mapping
-    uint8_t  HAT;    // HAT switch; one nibble w/ unused nibble
-    uint32_t axis;  // slider touch data
-    uint8_t  VendorSpec;
-} hid_joy, sent_hid_joy;
+static hid_joy_t hid_joy, sent_hid_joy;
+static hid_nkro_t hid_nkro, sent_hid_nkro;
 
-struct __attribute__((packed)) {
-    uint8_t modifier;
-    uint8_t keymap[15];
-} hid_nkro, sent_hid_nkro;
-
-void report_usb_hid()
+/* Called whenever there's a chance: a changed report goes out as soon as
+   the endpoint takes it, unchanged ones are resent every 2.5ms */
+static void report_usb_hid()
 {
     static uint64_t next_joy_time = 0;
     static uint64_t next_nkro_time = 0;
 
-    if (tud_hid_ready()) {
-        hid_joy.HAT = 0;
-        hid_joy.VendorSpec = 0;
-        if (chu_cfg->hid.joy) {
-            if ((memcmp(&hid_joy, &sent_hid_joy, sizeof(hid_joy)) != 0) ||
-                (time_us_64() > next_joy_time)) {
-                if (tud_hid_report(REPORT_ID_JOYSTICK, &hid_joy, sizeof(hid_joy))) {
-                    sent_hid_joy = hid_joy;
-                    next_joy_time = time_us_64() + 2500; // forced report every 4ms
+    hid_joy.HAT = 0;
+    hid_joy.VendorSpec = 0;
+
+    bool joy_changed = chu_cfg->hid.joy &&
+                       (memcmp(&hid_joy, &sent_hid_joy, sizeof(hid_joy)) != 0);
+    bool nkro_changed = chu_cfg->hid.nkro &&
+                        (memcmp(&hid_nkro, &sent_hid_nkro, sizeof(hid_nkro)) != 0);
+
+    if (!chu_cfg->hid.joy && !chu_cfg->hid.nkro) {
+        latency_cancel(); // nothing to send, nothing to time
+        return;
+    }
+
+    if (chu_cfg->hid.joy && tud_hid_ready()) {
+        if (joy_changed || (time_us_64() > next_joy_time)) {
+            if (tud_hid_report(REPORT_ID_JOYSTICK, &hid_joy, sizeof(hid_joy))) {
+                sent_hid_joy = hid_joy;
+                next_joy_time = time_us_64() + 2500;
+                if (joy_changed) {
+                    latency_end(time_us_32());
                 }
             }
         }
-        if (chu_cfg->hid.nkro) {
-            if ((memcmp(&hid_nkro, &sent_hid_nkro, sizeof(hid_nkro)) != 0) ||
-                (time_us_64() > next_nkro_time)) {
-                if (tud_hid_n_report(0x02, 0, &sent_hid_nkro, sizeof(sent_hid_nkro))) {
-                    sent_hid_nkro = hid_nkro;
-                    next_nkro_time = time_us_64() + 2500; // forced report every 4ms
+    }
+
+    if (chu_cfg->hid.nkro && tud_hid_n_ready(0x02)) {
+        if (nkro_changed || (time_us_64() > next_nkro_time)) {
+            if (tud_hid_n_report(0x02, 0, &hid_nkro, sizeof(hid_nkro))) {
+                sent_hid_nkro = hid_nkro;
+                next_nkro_time = time_us_64() + 2500;
+                if (nkro_changed) {
+                    latency_end(time_us_32());
                 }
             }
         }
     }
 }
 
-static void gen_joy_report()
+/* X, Y, Z and Rx carry up to 4 contact positions instead of key bits */
+static void gen_joy_positions()
 {
-    hid_joy.axis = 0;
-    for (int i = 0; i < 16; i++) {
-        if (slider_touched(i * 2)) {
-            hid_joy.axis |= 1 << (30 - i * 2);
-        }
-        if (slider_touched(i * 2 + 1)) {
-            hid_joy.axis |= 1 << (31 - i * 2);
-        }
+    uint8_t pos[ANALOG_MAX_CONTACTS];
+    slider_contacts(pos);
+    hid_joy.axis = pos[0] | (pos[1] << 8) | (pos[2] << 16) | (pos[3] << 24);
+}
 
+static void gen_joy_report()
+{
+    report_gen_joy(&hid_joy, slider_bitmap(), air_bitmap(), button_read());
+    if (chu_cfg->tweak.touch_mode == 2) {
+        gen_joy_positions();
     }
-    hid_joy.axis ^= 0x80808080; // some magic number from CrazyRedMachine
-    uint16_t airmap = air_bitmap();
-
-    /* to cope with Redboard mapping which I don't really understand why */
-    hid_joy.buttons = ((airmap >> 1) & 0x07) | ((airmap & 0x01) << 3) | (airmap & 0x30);
 
-    uint16_t aux = button_read();
-    hid_joy.buttons |= (aux & 0x01) ? 0x200 : 0; // START
-    hid_joy.buttons |= (aux & 0x02) ? 0x100 : 0; // SERVICE
-    hid_joy.buttons |= (aux & 0x04) ? 0x1000 : 0; // TEST
+    latency_mark(LATENCY_BUILT, time_us_32());
 }
 
-const uint8_t keycode_table[128][2] = { HID_ASCII_TO_KEYCODE };
-const uint8_t keymap[41 + 1] = NKRO_KEYMAP; // 32 keys, 6 air keys, 3 aux, 1 terminator
 static void gen_nkro_report()
 {
-    for (int i = 0; i < 32; i++) {
-        uint8_t code = keycode_table[keymap[i]][1];
-        uint8_t byte = code / 8;
-        uint8_t bit = code % 8;
-        if (slider_touched(i)) {
-            hid_nkro.keymap[byte] |= (1 << bit);
-        } else {
-            hid_nkro.keymap[byte] &= ~(1 << bit);
-        }
-    }
-
-    uint16_t airmap = air_bitmap();
-    for (int i = 0; i < 6; i++) {
-        uint8_t code = keycode_table[keymap[32 + i]][1];
-        uint8_t byte = code / 8;
-        uint8_t bit = code % 8;
-        if (airmap & (1 << i)) {
-            hid_nkro.keymap[byte] |= (1 << bit);
-        } else {
-            hid_nkro.keymap[byte] &= ~(1 << bit);
-        }
-    }
-
-    uint16_t aux = button_read();
-    for (int i = 0; i < 3; i++) {
-        uint8_t code = keycode_table[keymap[38 + i]][1];
-        uint8_t byte = code / 8;
-        uint8_t bit = code % 8;
-        if (aux & (1 << i)) {
-            hid_nkro.keymap[byte] |= (1 << bit);
-        } else {
-            hid_nkro.keymap[byte] &= ~(1 << bit);
-        }
-    }
+    report_gen_nkro(&hid_nkro, slider_bitmap(), air_bitmap(), button_read());
 }
 
 static uint64_t last_hid_time = 0;
@@ -150,23 +122,12 @@ static void run_lights()
     uint64_t now = time_us_64();
 
     if (now - last_hid_time >= 1000000) {
-        const uint32_t colors[] = {0x000000, 0x0000ff, 0xff0000, 0xffff00,
-                                0x00ff00, 0x00ffff, 0xffffff};
-        for (int i = 0; i < air_tof_num(); i++) {
-            int d = air_tof_value(i);
-            rgb_set_color(31 + i, colors[d]);
-        }
-
-        for (int i = 0; i < 15; i++) {
-            uint32_t color = rgb32_from_hsv(i * 573 / 15, 255, 16);
-            rgb_gap_color(i, color);
-        }
-
-        for (int i = 0; i < 16; i++) {
-            bool r = slider_touched(i * 2);
-            bool g = slider_touched(i * 2 + 1);
-            rgb_set_color(30 - i * 2, rgb32(r ? 80 : 0, g ? 80 : 0, 0, false));
+        lights_input_t input = { .touched = slider_bitmap() };
+        input.tof_num = air_tof_num();
+        for (int i = 0; i < input.tof_num; i++) {
+            input.tof[i] = air_tof_value(i);
         }
+        lights_update(now, &input);
     }
 
     uint32_t aime_color = aime_led_color();
@@ -205,17 +166,24 @@ static void aime_run()
 
 static void runtime_ctrl()
 {
-    /* Just use long-press SERVICE to reset touch in runtime */
+    /* Just use long-press SERVICE to reset touch in runtime,
+       or hold SERVICE and press START for the next profile */
     static bool applied = false;
     static uint64_t press_time = 0;
     static bool last_svc_button = false;
+    static bool last_start_button = false;
     bool svc_button = button_read() & 0x02;
+    bool start_button = button_read() & 0x01;
 
     if (svc_button) {
         if (!last_svc_button) {
             press_time = time_us_64();
             applied = false;
         }
+        if (start_button && !last_start_button) {
+            profile_next();
+            applied = true;
+        }
         if (!applied && (time_us_64() - press_time > 2000000)) {
             slider_sensor_init();
             applied = true;
@@ -223,6 +191,7 @@ static void runtime_ctrl()
     }
 
     last_svc_button = svc_button;
+    last_start_button = start_button;
 }
 
 static mutex_t core1_io_lock;
@@ -230,39 +199,134 @@ static void core1_loop()
 {
     while (1) {
         if (mutex_try_enter(&core1_io_lock, NULL)) {
+            perf_begin(PERF_LIGHTS);
+            rgb_pull_host();
             run_lights();
+            perf_end(PERF_LIGHTS);
+
+            perf_begin(PERF_RGB);
             rgb_update();
+            perf_end(PERF_RGB);
             mutex_exit(&core1_io_lock);
         }
-        cli_fps_count(1);
+        perf_frame(1, false);
         sleep_ms(1);
     }
 }
 
+/* Sensor scan runs in I2C IRQ and gets the bus time of what it queued,
+   plus some for IRQ latency. Past this much of a frame, the frame is
+   made longer instead of cutting the scan short. */
+#define SCAN_BUDGET_US 800
+#define SCAN_MARGIN_US 100
+/* Housekeeping is skipped in frames where what it has been taking lately
+   doesn't fit, but not for longer than this many frames in a row */
+#define HOUSEKEEPING_MAX_DEFER 50
+#define FRAME_US 1000
+
+/* Deadline for the frame about to start. If we're a whole frame or more
+   behind, start over from now instead of bursting through missed ones. */
+static uint64_t next_deadline(uint64_t deadline)
+{
+    uint64_t now = time_us_64();
+    deadline += FRAME_US;
+    if (now >= deadline) {
+        perf_dropped(0, (now - deadline) / FRAME_US + 1);
+        deadline = now + FRAME_US;
+    }
+    return deadline;
+}
+
+/* Use the rest of the frame: housekeeping first, then keep USB serviced
+   so a pending report goes out the moment the endpoint frees up.
+   Idle housekeeping takes a few us, a slow one (card read, flash step)
+   raises the estimate and it decays back over the following frames. */
+static void core0_idle(uint64_t deadline)
+{
+    static int deferred = 0;
+    static uint32_t cost_us = 0;
+
+    uint64_t now = time_us_64();
+    if ((now + cost_us >= deadline) && (deferred < HOUSEKEEPING_MAX_DEFER)) {
+        deferred++;
+        cost_us -= cost_us / 8;
+        perf_deferred(0);
+    } else {
+        deferred = 0;
+        perf_begin(PERF_CLI);
+        cli_run();
+        perf_end(PERF_CLI);
+
+        perf_begin(PERF_AIME);
+        aime_run();
+        perf_end(PERF_AIME);
+
+        perf_begin(PERF_SAVE);
+        save_loop();
+        perf_end(PERF_SAVE);
+
+        uint32_t spent = time_us_64() - now;
+        cost_us = spent > cost_us ? spent : cost_us - (cost_us - spent) / 8;
+    }
+
+    while (time_us_64() < deadline) {
+        tud_task();
+        report_usb_hid();
+    }
+}
+
 static void core0_loop()
 {
     uint64_t next_frame = time_us_64();
     while(1) {
+        next_frame = next_deadline(next_frame);
+        save_frame();
+
+        slider_scan();
+        air_scan();
+        uint32_t scan_us = i2c_scan_bus_us(I2C_FREQ) + SCAN_MARGIN_US;
+        if (scan_us > SCAN_BUDGET_US) {
+            next_frame += scan_us - SCAN_BUDGET_US;
+        }
+        i2c_scan_start();
+
+        perf_begin(PERF_TUD);
         tud_task();
+        perf_end(PERF_TUD);
 
-        cli_run();
-        aime_run();
-    
-        save_loop();
-        cli_fps_count(0);
+        perf_begin(PERF_BUTTON);
+        button_update();
+        perf_end(PERF_BUTTON);
+
+        /* bus is idle after this, blocking I2C users are safe below */
+        perf_begin(PERF_SCAN);
+        i2c_scan_sync(scan_us);
+        perf_end(PERF_SCAN);
 
+        perf_begin(PERF_SLIDER);
         slider_update();
+        perf_end(PERF_SLIDER);
+
+        perf_begin(PERF_AIR);
         air_update();
-        button_update();
+        perf_end(PERF_AIR);
 
+        trace_frame();
+
+        perf_begin(PERF_REPORT);
         gen_joy_report();
         gen_nkro_report();
         report_usb_hid();
+        perf_end(PERF_REPORT);
+
+        if (slider_bitmap() || air_bitmap() || button_read()) {
+            save_hold();
+        }
 
         runtime_ctrl();
+        perf_frame(0, time_us_64() > next_frame);
 
-        sleep_until(next_frame);
-        next_frame += 1000;
+        core0_idle(next_frame);
     }
 }
 
@@ -302,13 +366,16 @@ void init()
     stdio_init_all();
 
     config_init();
+    profile_init();
     mutex_init(&core1_io_lock);
     save_init(0xca34cafe, &core1_io_lock);
 
     button_init();
+    i2c_scan_init(I2C_PORT); // slider and air bring the bus up through it
     slider_init();
     air_init();
     rgb_init();
+    lights_init();
 
     nfc_attach_i2c(I2C_PORT);
     i2c_select(I2C_PORT, 1 << 5); // PN532 on IR1 (I2C mux chn 5)
@@ -355,6 +422,8 @@ void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id,
             rgb_set_brg(16, buffer, bufsize / 3);
         } else if (report_id == REPORT_ID_LED_TOWER_6) {
             rgb_set_brg(31, buffer, bufsize / 3);
+        } else if (report_id == REPORT_ID_LED_DELTA) {
+            rgb_set_brg_delta(buffer, bufsize);
         }
         last_hid_time = time_us_64();
         return;
@@ -362,11 +431,7 @@ void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id,
     
     if (report_type == HID_REPORT_TYPE_FEATURE) {
         if (report_id == REPORT_ID_LED_COMPRESSED) {
-            uint8_t buf[(48 + 45 + 6) * 3];
-            unsigned int olen = sizeof(buf);
-            if (lzfx_decompress(buffer + 1, buffer[0], buf, &olen) == 0) {
-                rgb_set_brg(0, buf, olen / 3);
-            }
+            rgb_set_brg_lzfx(buffer + 1, buffer[0]);
 
             if (!chu_cfg->hid.joy) {
                 chu_cfg->hid.joy = 1;
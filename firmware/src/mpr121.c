@@ -14,9 +14,6 @@
 
 #define IO_TIMEOUT_US 1000
 
-#define TOUCH_THRESHOLD_BASE 22
-#define RELEASE_THRESHOLD_BASE 15
-
 #define MPR121_TOUCH_STATUS_REG 0x00
 #define MPR121_OUT_OF_RANGE_STATUS_0_REG 0x02
 #define MPR121_OUT_OF_RANGE_STATUS_1_REG 0x03
@@ -59,6 +56,32 @@
 #define MPR121_AUTOCONFIG_TARGET_REG 0x7F
 #define MPR121_SOFT_RESET_REG 0x80
 
+/* Config registers are shadowed, so changes only write what differs */
+#define CFG_FIRST_REG MPR121_MAX_HALF_DELTA_RISING_REG
+#define CFG_LAST_REG MPR121_AUTOCONFIG_TARGET_REG
+#define CFG_REG_NUM (CFG_LAST_REG - CFG_FIRST_REG + 1)
+#define CFG(reg) ((reg) - CFG_FIRST_REG)
+
+#define BASE_ADDR 0x5A
+#define ADDR_NUM 4
+
+typedef struct {
+    uint8_t target[CFG_REG_NUM]; // what we want
+    uint8_t chip[CFG_REG_NUM];   // what the chip has, if known
+    bool wanted[CFG_REG_NUM];
+    bool known[CFG_REG_NUM];
+} shadow_t;
+
+static shadow_t shadows[ADDR_NUM];
+
+static shadow_t *shadow_of(uint8_t addr)
+{
+    if ((addr < BASE_ADDR) || (addr >= BASE_ADDR + ADDR_NUM)) {
+        return NULL;
+    }
+    return &shadows[addr - BASE_ADDR];
+}
+
 static void write_reg(uint8_t addr, uint8_t reg, uint8_t val)
 {
     uint8_t buf[] = {reg, val};
@@ -66,6 +89,16 @@ static void write_reg(uint8_t addr, uint8_t reg, uint8_t val)
                              time_us_64() + IO_TIMEOUT_US);
 }
 
+/* Auto-increment burst, one address phase for a run of registers */
+static bool write_regs(uint8_t addr, uint8_t reg, const uint8_t *vals, int num)
+{
+    uint8_t buf[CFG_REG_NUM + 1];
+    buf[0] = reg;
+    memcpy(buf + 1, vals, num);
+    return i2c_write_blocking_until(I2C_PORT, addr, buf, num + 1, false,
+                        time_us_64() + IO_TIMEOUT_US * (num + 1) / 2) == num + 1;
+}
+
 static uint8_t read_reg(uint8_t addr, uint8_t reg)
 {
     uint8_t value = 0;
@@ -76,48 +109,108 @@ static uint8_t read_reg(uint8_t addr, uint8_t reg)
     return value;
 }
 
+static void stage(shadow_t *shadow, uint8_t reg, uint8_t val)
+{
+    shadow->target[CFG(reg)] = val;
+    shadow->wanted[CFG(reg)] = true;
+}
+
+static inline bool stale(const shadow_t *shadow, int i)
+{
+    return shadow->wanted[i] &&
+           (!shadow->known[i] || (shadow->chip[i] != shadow->target[i]));
+}
+
+void mpr121_apply(uint8_t addr)
+{
+    shadow_t *shadow = shadow_of(addr);
+    if (!shadow) {
+        return;
+    }
+
+    int first = -1;
+    for (int i = 0; i < CFG_REG_NUM; i++) {
+        if (stale(shadow, i)) {
+            first = i;
+            break;
+        }
+    }
+    if (first < 0) {
+        return;
+    }
+
+    /* electrodes are off only for this window */
+    write_reg(addr, MPR121_ELECTRODE_CONFIG_REG, MPR121_RUN_ECR & 0xC0);
+
+    for (int i = first; i < CFG_REG_NUM; ) {
+        if (!stale(shadow, i) || (i == CFG(MPR121_ELECTRODE_CONFIG_REG))) {
+            i++;
+            continue;
+        }
+        int end = i + 1;
+        while ((end < CFG_REG_NUM) && stale(shadow, end) &&
+               (end != CFG(MPR121_ELECTRODE_CONFIG_REG))) {
+            end++;
+        }
+        bool ok = write_regs(addr, CFG_FIRST_REG + i, shadow->target + i, end - i);
+        for (int j = i; j < end; j++) {
+            shadow->chip[j] = shadow->target[j];
+            shadow->known[j] = ok;
+        }
+        i = end;
+    }
+
+    write_reg(addr, MPR121_ELECTRODE_CONFIG_REG, MPR121_RUN_ECR);
+}
+
 bool mpr121_init(uint8_t i2c_addr)
 {
+    shadow_t *shadow = shadow_of(i2c_addr);
+    if (!shadow) {
+        return false;
+    }
+
     write_reg(i2c_addr, 0x80, 0x63); // Soft reset MPR121 if not reset correctly 
+    memset(shadow, 0, sizeof(*shadow));
 
     //touch pad baseline filter 
     //rising: baseline quick rising 
-    write_reg(i2c_addr, 0x2B, 1); // Max half delta Rising 
-    write_reg(i2c_addr, 0x2C, 1); // Noise half delta Rising 
-    write_reg(i2c_addr, 0x2D, 1); // Noise count limit Rising 
-    write_reg(i2c_addr, 0x2E, 1); // Delay limit Rising
+    stage(shadow, 0x2B, 1); // Max half delta Rising 
+    stage(shadow, 0x2C, 1); // Noise half delta Rising 
+    stage(shadow, 0x2D, 1); // Noise count limit Rising 
+    stage(shadow, 0x2E, 1); // Delay limit Rising
 
     //falling: baseline slow falling 
-    write_reg(i2c_addr, 0x2F, 1); // Max half delta Falling 
-    write_reg(i2c_addr, 0x30, 1); // Noise half delta Falling 
-    write_reg(i2c_addr, 0x31, 6); // Noise count limit Falling 
-    write_reg(i2c_addr, 0x32, 12); // Delay limit Falling
+    stage(shadow, 0x2F, 1); // Max half delta Falling 
+    stage(shadow, 0x30, 1); // Noise half delta Falling 
+    stage(shadow, 0x31, 6); // Noise count limit Falling 
+    stage(shadow, 0x32, 12); // Delay limit Falling
 
     //touched: baseline very slow falling
-    write_reg(i2c_addr, 0x33, 1); // Noise half delta Touched 
-    write_reg(i2c_addr, 0x34, 8); // Noise count Touched 
-    write_reg(i2c_addr, 0x35, 30); // Delay limit Touched 
+    stage(shadow, 0x33, 1); // Noise half delta Touched 
+    stage(shadow, 0x34, 8); // Noise count Touched 
+    stage(shadow, 0x35, 30); // Delay limit Touched 
 
     //Touch pad threshold 
     for (int i = 0; i < 12; i++) {
-        write_reg(i2c_addr, 0x41 + i * 2, TOUCH_THRESHOLD_BASE);
-        write_reg(i2c_addr, 0x42 + i * 2, RELEASE_THRESHOLD_BASE);
+        stage(shadow, 0x41 + i * 2, MPR121_TOUCH_THRESHOLD_BASE);
+        stage(shadow, 0x42 + i * 2, MPR121_RELEASE_THRESHOLD_BASE);
     }
 
     //touch and release debounce 
-    write_reg(i2c_addr, 0x5B, 0x00);
+    stage(shadow, 0x5B, 0x00);
 
     //AFE and filter configuration 
-    write_reg(i2c_addr, 0x5C, 0b00010000); // AFES=6 samples, same as AFES in 0x7B, Global CDC=16uA 
-    write_reg(i2c_addr, 0x5D, 0b00101000); // CT=0.5us, TDS=4samples, TDI=16ms 
-    write_reg(i2c_addr, 0x5E, 0x80); // Set baseline calibration enabled, baseline loading 5MSB 
+    stage(shadow, 0x5C, 0b00010000); // AFES=6 samples, same as AFES in 0x7B, Global CDC=16uA 
+    stage(shadow, 0x5D, 0b00101000); // CT=0.5us, TDS=4samples, TDI=16ms 
+    // 0x5E: baseline calibration enabled, baseline loading 5MSB, by mpr121_apply()
 
     //Auto Configuration 
-    write_reg(i2c_addr, 0x7B, 0b00001011); // AFES=6 samples, same as AFES in 0x5C 
+    stage(shadow, 0x7B, 0b00001011); // AFES=6 samples, same as AFES in 0x5C 
     // retry=2b00, no retry, 
     // BVA=2b10, load 5MSB after AC, 
     // ARE/ACE=2b11, auto configuration enabled 
-    //write_reg(i2c_addr, 0x7C,0x80); // Skip charge time search, use setting in 0x5D, 
+    //stage(shadow, 0x7C,0x80); // Skip charge time search, use setting in 0x5D, 
     // OOR, AR, AC IE disabled 
     // Not used. Possible Proximity CDC shall over 63uA 
     // if only use 0.5uS CDT, the TGL for proximity cannot meet 
@@ -126,24 +219,24 @@ bool mpr121_init(uint8_t i2c_addr)
 
     // I want to max out sensitivity, I don't care linearity
     const uint8_t usl = (3.3 - 0.1) / 3.3 * 256;
-    write_reg(i2c_addr, 0x7D, usl),  
-    write_reg(i2c_addr, 0x7E, usl * 0.65),
-    write_reg(i2c_addr, 0x7F, usl * 0.9);
+    stage(shadow, 0x7D, usl);
+    stage(shadow, 0x7E, usl * 0.65);
+    stage(shadow, 0x7F, usl * 0.9);
 
-    write_reg(i2c_addr, 0x5E, 0x8C); // Run 12 touch, load 5MSB to baseline 
+    mpr121_apply(i2c_addr); // ends with 0x8C, run 12 touch, load 5MSB to baseline 
 
     uint8_t check = read_reg(i2c_addr, 0x5E);
-    return (check == 0x8C);
+    return (check == MPR121_RUN_ECR);
 }
 
 #define ABS(x) ((x) < 0 ? -(x) : (x))
 
-static void mpr121_read_many(uint8_t addr, uint8_t reg, uint8_t *buf, int num)
+static bool mpr121_read_many(uint8_t addr, uint8_t reg, uint8_t *buf, int num)
 {
     i2c_write_blocking_until(I2C_PORT, addr, &reg, 1, true,
                              time_us_64() + IO_TIMEOUT_US);
-    i2c_read_blocking_until(I2C_PORT, addr, buf, num, false,
-                             time_us_64() + IO_TIMEOUT_US * num / 2);
+    return i2c_read_blocking_until(I2C_PORT, addr, buf, num, false,
+                                   time_us_64() + IO_TIMEOUT_US * num / 2) == num;
 }
 
 static void mpr121_read_many16(uint8_t addr, uint8_t reg, uint16_t *buf, int num)
@@ -164,54 +257,67 @@ uint16_t mpr121_touched(uint8_t addr)
     return touched;
 }
 
-void mpr121_raw(uint8_t addr, uint16_t *raw, int num)
+static_assert(sizeof(mpr121_frame_t) >= MPR121_FRAME_FULL_LEN, "MPR121 frame too small");
+
+/* Auto-increment burst from touch status, saves the address/restart cost
+   of reading status, filtered data and baseline separately */
+bool mpr121_read_frame(uint8_t addr, mpr121_frame_t *frame, bool analog)
 {
-    mpr121_read_many16(addr, MPR121_ELECTRODE_FILTERED_DATA_REG, raw, num);
+    int len = analog ? MPR121_FRAME_FULL_LEN : MPR121_FRAME_STATUS_LEN;
+    return mpr121_read_many(addr, MPR121_TOUCH_STATUS_REG, (uint8_t *)frame, len);
 }
 
-static uint8_t mpr121_stop(uint8_t addr)
+bool mpr121_scan_frame(uint8_t addr, mpr121_frame_t *frame, bool analog,
+                       i2c_txn_cb cb, uint32_t arg)
 {
-    uint8_t ecr = read_reg(addr, MPR121_ELECTRODE_CONFIG_REG);
-    write_reg(addr, MPR121_ELECTRODE_CONFIG_REG, ecr & 0xC0);
-    return ecr;
+    int len = analog ? MPR121_FRAME_FULL_LEN : MPR121_FRAME_STATUS_LEN;
+    return i2c_scan_read(addr, MPR121_TOUCH_STATUS_REG, (uint8_t *)frame, len,
+                         cb, arg);
 }
 
-static void mpr121_resume(uint8_t addr, uint8_t ecr)
+bool mpr121_scan_ecr(uint8_t addr, uint8_t *ecr, i2c_txn_cb cb, uint32_t arg)
 {
-    write_reg(addr, MPR121_ELECTRODE_CONFIG_REG, ecr);
+    return i2c_scan_read(addr, MPR121_ELECTRODE_CONFIG_REG, ecr, 1, cb, arg);
 }
 
+/* These only stage, mpr121_apply() writes them */
 void mpr121_filter(uint8_t addr, uint8_t ffi, uint8_t sfi, uint8_t esi)
 {
-    uint8_t ecr = mpr121_stop(addr);
-
-    uint8_t afe = read_reg(addr, MPR121_AFE_CONFIG_REG);
-    write_reg(addr, MPR121_AFE_CONFIG_REG, (afe & 0x3f) | ffi << 6);
-    uint8_t acc = read_reg(addr, MPR121_AUTOCONFIG_CONTROL_0_REG);
-    write_reg(addr, MPR121_AUTOCONFIG_CONTROL_0_REG, (acc & 0x3f) | ffi << 6);
-    uint8_t fcr = read_reg(addr, MPR121_FILTER_CONFIG_REG);
-    write_reg(addr, MPR121_FILTER_CONFIG_REG,
-              (fcr & 0xe0) | ((sfi & 3) << 3) | esi);
+    shadow_t *shadow = shadow_of(addr);
+    if (!shadow) {
+        return;
+    }
 
-    mpr121_resume(addr, ecr);
+    uint8_t afe = shadow->target[CFG(MPR121_AFE_CONFIG_REG)];
+    stage(shadow, MPR121_AFE_CONFIG_REG, (afe & 0x3f) | ffi << 6);
+    uint8_t acc = shadow->target[CFG(MPR121_AUTOCONFIG_CONTROL_0_REG)];
+    stage(shadow, MPR121_AUTOCONFIG_CONTROL_0_REG, (acc & 0x3f) | ffi << 6);
+    uint8_t fcr = shadow->target[CFG(MPR121_FILTER_CONFIG_REG)];
+    stage(shadow, MPR121_FILTER_CONFIG_REG,
+          (fcr & 0xe0) | ((sfi & 3) << 3) | esi);
 }
 
 void mpr121_sense(uint8_t addr, int8_t sense, int8_t *sense_keys, int num)
 {
-    uint8_t ecr = mpr121_stop(addr);
+    shadow_t *shadow = shadow_of(addr);
+    if (!shadow) {
+        return;
+    }
+
     for (int i = 0; (i < num) && (i < 12); i++) {
         int8_t delta = sense + sense_keys[i];
-        write_reg(addr, MPR121_TOUCH_THRESHOLD_REG + i * 2,
-                        TOUCH_THRESHOLD_BASE - delta);
-        write_reg(addr, MPR121_RELEASE_THRESHOLD_REG + i * 2,
-                        RELEASE_THRESHOLD_BASE - delta / 2);
+        stage(shadow, MPR121_TOUCH_THRESHOLD_REG + i * 2,
+                      mpr121_touch_threshold(delta));
+        stage(shadow, MPR121_RELEASE_THRESHOLD_REG + i * 2,
+                      mpr121_release_threshold(delta));
     }
-    mpr121_resume(addr, ecr);
 }
 
 void mpr121_debounce(uint8_t addr, uint8_t touch, uint8_t release)
 {
-    uint8_t ecr = mpr121_stop(addr);
-    write_reg(addr, 0x5B, (release & 0x07) << 4 | (touch & 0x07));
-    mpr121_resume(addr, ecr);
+    shadow_t *shadow = shadow_of(addr);
+    if (!shadow) {
+        return;
+    }
+    stage(shadow, MPR121_DEBOUNCE_REG, (release & 0x07) << 4 | (touch & 0x07));
 }
@@ -7,12 +7,51 @@
 #ifndef MP121_H
 #define MP121_H
 
+#include "i2c_scan.h"
+
+/* Register 0x00 to 0x2A in one go, same layout as the chip */
+typedef struct __attribute__((packed, aligned(4))) {
+    uint16_t touched;
+    uint16_t oor;
+    uint16_t filtered[13]; // 10 bits, 12 electrodes + proximity
+    uint8_t baseline[13];  // higher 8 bits of 10
+} mpr121_frame_t;
+
+#define MPR121_FRAME_STATUS_LEN 4
+#define MPR121_FRAME_FULL_LEN 0x2B
+
+#define MPR121_RUN_ECR 0x8C // Run 12 touch, load 5MSB to baseline
+
+#define MPR121_TOUCH_THRESHOLD_BASE 22
+#define MPR121_RELEASE_THRESHOLD_BASE 15
+
+/* sense: higher is more sensitive */
+static inline uint8_t mpr121_touch_threshold(int8_t sense)
+{
+    return MPR121_TOUCH_THRESHOLD_BASE - sense;
+}
+
+static inline uint8_t mpr121_release_threshold(int8_t sense)
+{
+    return MPR121_RELEASE_THRESHOLD_BASE - sense / 2;
+}
+
 bool mpr121_init(uint8_t addr);
 
 uint16_t mpr121_touched(uint8_t addr);
-void mpr121_raw(uint8_t addr, uint16_t *raw, int num);
+
+/* analog: also read filtered data and baseline, not just status */
+bool mpr121_read_frame(uint8_t addr, mpr121_frame_t *frame, bool analog);
+bool mpr121_scan_frame(uint8_t addr, mpr121_frame_t *frame, bool analog,
+                       i2c_txn_cb cb, uint32_t arg);
+/* ECR reads back as MPR121_RUN_ECR while the chip is configured and running */
+bool mpr121_scan_ecr(uint8_t addr, uint8_t *ecr, i2c_txn_cb cb, uint32_t arg);
+
+/* Config changes are staged, mpr121_apply() writes only the registers
+   that differ from the chip, in bursts, in one stop/resume window */
 void mpr121_filter(uint8_t addr, uint8_t ffi, uint8_t sfi, uint8_t esi);
 void mpr121_sense(uint8_t addr, int8_t sense, int8_t *sense_keys, int num);
 void mpr121_debounce(uint8_t addr, uint8_t touch, uint8_t release);
+void mpr121_apply(uint8_t addr);
 
 #endif
@@ -0,0 +1,163 @@
+/*
+ * Per-Core Section Profiler
+ * WHowe <github.com/whowechina>
+ *
+ * Begin/end markers around the main loop sections, accumulated over a
+ * second and published as average and max per section.
+ */
+
+#include "perf.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "hardware/timer.h"
+
+#include "cli.h"
+
+static const struct {
+    const char *name;
+    uint8_t core;
+} sections[PERF_SECTION_NUM] = {
+    [PERF_TUD] = { "tud", 0 },
+    [PERF_BUTTON] = { "button", 0 },
+    [PERF_SCAN] = { "scan", 0 },
+    [PERF_SLIDER] = { "slider", 0 },
+    [PERF_AIR] = { "air", 0 },
+    [PERF_REPORT] = { "report", 0 },
+    [PERF_CLI] = { "cli", 0 },
+    [PERF_AIME] = { "aime", 0 },
+    [PERF_SAVE] = { "save", 0 },
+    [PERF_LIGHTS] = { "lights", 1 },
+    [PERF_RGB] = { "rgb", 1 },
+};
+
+static struct {
+    uint32_t start;
+    uint32_t count;
+    uint32_t total;
+    uint32_t max;
+} acc[PERF_SECTION_NUM];
+
+static perf_stat_t stats[PERF_SECTION_NUM];
+
+static struct {
+    uint32_t window;
+    uint32_t frames;
+    uint32_t missed;
+    uint32_t dropped;
+    uint32_t deferred;
+} cores[2];
+
+static perf_core_t core_stats[2];
+
+/* Each core clears its own counters, a reset from the other one only asks */
+static volatile bool reset_request[2];
+
+static void reset_core(int core)
+{
+    for (int i = 0; i < PERF_SECTION_NUM; i++) {
+        if (sections[i].core == core) {
+            memset(&stats[i], 0, sizeof(stats[i]));
+        }
+    }
+    cores[core].missed = 0;
+    cores[core].dropped = 0;
+    cores[core].deferred = 0;
+    core_stats[core].missed = 0;
+    core_stats[core].dropped = 0;
+    core_stats[core].deferred = 0;
+}
+
+void perf_begin(perf_section_t section)
+{
+    acc[section].start = time_us_32();
+}
+
+void perf_end(perf_section_t section)
+{
+    uint32_t elapsed = time_us_32() - acc[section].start;
+    acc[section].count++;
+    acc[section].total += elapsed;
+    if (elapsed > acc[section].max) {
+        acc[section].max = elapsed;
+    }
+}
+
+void perf_frame(int core, bool missed)
+{
+    if (reset_request[core]) {
+        reset_request[core] = false;
+        reset_core(core);
+    }
+
+    cores[core].frames++;
+    if (missed) {
+        cores[core].missed++;
+    }
+    cli_fps_count(core);
+
+    uint32_t now = time_us_32();
+    if (now - cores[core].window < 1000000) {
+        return;
+    }
+    cores[core].window = now;
+
+    uint32_t busy = 0;
+    for (int i = 0; i < PERF_SECTION_NUM; i++) {
+        if (sections[i].core != core) {
+            continue;
+        }
+        stats[i].count = acc[i].count;
+        stats[i].avg = acc[i].count ? acc[i].total / acc[i].count : 0;
+        stats[i].max = acc[i].max;
+        busy += acc[i].total;
+        acc[i].count = 0;
+        acc[i].total = 0;
+        acc[i].max = 0;
+    }
+
+    core_stats[core].frames = cores[core].frames;
+    core_stats[core].busy = busy;
+    core_stats[core].missed = cores[core].missed;
+    core_stats[core].dropped = cores[core].dropped;
+    core_stats[core].deferred = cores[core].deferred;
+    cores[core].frames = 0;
+}
+
+void perf_dropped(int core, unsigned frames)
+{
+    cores[core].dropped += frames;
+}
+
+void perf_deferred(int core)
+{
+    cores[core].deferred++;
+}
+
+const char *perf_name(perf_section_t section)
+{
+    return sections[section].name;
+}
+
+int perf_core(perf_section_t section)
+{
+    return sections[section].core;
+}
+
+void perf_stat(perf_section_t section, perf_stat_t *stat)
+{
+    *stat = stats[section];
+}
+
+void perf_core_stat(int core, perf_core_t *stat)
+{
+    *stat = core_stats[core];
+}
+
+void perf_reset()
+{
+    reset_request[0] = true;
+    reset_request[1] = true;
+}
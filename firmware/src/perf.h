@@ -0,0 +1,60 @@
+/*
+ * Per-Core Section Profiler
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    /* core 0 */
+    PERF_TUD = 0,
+    PERF_BUTTON,
+    PERF_SCAN,   // waiting for the I2C scan to finish
+    PERF_SLIDER,
+    PERF_AIR,
+    PERF_REPORT, // HID report generation and sending
+    PERF_CLI,
+    PERF_AIME,
+    PERF_SAVE,
+    /* core 1 */
+    PERF_LIGHTS,
+    PERF_RGB,
+    PERF_SECTION_NUM
+} perf_section_t;
+
+typedef struct {
+    uint32_t count; // calls in the last second
+    uint32_t avg;   // us
+    uint32_t max;   // us
+} perf_stat_t;
+
+typedef struct {
+    uint32_t frames;   // loops in the last second
+    uint32_t busy;     // us spent in sections in the last second
+    /* since reset */
+    uint32_t missed;   // frames overrun their deadline
+    uint32_t dropped;  // frame slots given up to re-anchor the schedule
+    uint32_t deferred; // frames without room for housekeeping
+} perf_core_t;
+
+/* Hot path, only from the core the section belongs to */
+void perf_begin(perf_section_t section);
+void perf_end(perf_section_t section);
+
+/* Once per loop, also rolls the statistics over every second */
+void perf_frame(int core, bool missed);
+void perf_dropped(int core, unsigned frames);
+void perf_deferred(int core);
+
+const char *perf_name(perf_section_t section);
+int perf_core(perf_section_t section);
+void perf_stat(perf_section_t section, perf_stat_t *stat);
+void perf_core_stat(int core, perf_core_t *stat);
+/* Done by each core at its next perf_frame(), from either core */
+void perf_reset();
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * Config Profiles
+ * WHowe <github.com/whowechina>
+ *
+ * A few named sets of sensor and HID settings. chu_cfg always holds the
+ * live settings, a profile is only read or written when switching.
+ */
+
+#include "profile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "config.h"
+#include "save.h"
+#include "slider.h"
+#include "air.h"
+#include "report.h"
+
+typedef struct __attribute__((packed)) {
+    char name[PROFILE_NAME_LEN]; // empty means never set
+    chu_tof_cfg_t tof;
+    chu_sense_cfg_t sense;
+    chu_hid_cfg_t hid;
+    chu_ir_cfg_t ir;
+} profile_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t active;
+    profile_t profiles[PROFILE_NUM];
+} profile_store_t;
+
+static profile_store_t *store;
+static profile_store_t default_store = {0};
+
+static const char *default_names[PROFILE_NUM] = { "home", "arcade", "ir", "tof" };
+
+static void profile_store(profile_t *profile)
+{
+    profile->tof = chu_cfg->tof;
+    profile->sense = chu_cfg->sense;
+    profile->hid = chu_cfg->hid;
+    profile->ir = chu_cfg->ir;
+}
+
+static void profile_load(const profile_t *profile)
+{
+    chu_cfg->tof = profile->tof;
+    chu_cfg->sense = profile->sense;
+    chu_cfg->hid = profile->hid;
+    chu_cfg->ir = profile->ir;
+}
+
+/* Unset profiles start as a copy of the live settings */
+static void profile_fill(int index)
+{
+    profile_t *profile = &store->profiles[index];
+    memset(profile, 0, sizeof(*profile));
+    strncpy(profile->name, default_names[index], PROFILE_NAME_LEN - 1);
+    profile_store(profile);
+}
+
+static void profile_loaded()
+{
+    if (store->active >= PROFILE_NUM) {
+        store->active = 0;
+        config_changed();
+    }
+    for (int i = 0; i < PROFILE_NUM; i++) {
+        const char *name = store->profiles[i].name;
+        if ((name[0] == 0) || (strnlen(name, PROFILE_NAME_LEN) == PROFILE_NAME_LEN)) {
+            profile_fill(i);
+            config_changed();
+        }
+    }
+    /* live settings are what counts, the active profile follows them */
+    profile_store(&store->profiles[store->active]);
+}
+
+void profile_init()
+{
+    store = (profile_store_t *)save_alloc(sizeof(*store), &default_store,
+                                          profile_loaded);
+}
+
+int profile_active()
+{
+    return store->active;
+}
+
+const char *profile_name(int index)
+{
+    if ((index < 0) || (index >= PROFILE_NUM)) {
+        return "";
+    }
+    return store->profiles[index].name;
+}
+
+int profile_find(const char *prefix)
+{
+    int found = -1;
+    for (int i = 0; i < PROFILE_NUM; i++) {
+        const char *name = store->profiles[i].name;
+        if (strcasecmp(name, prefix) == 0) {
+            return i;
+        }
+        if (strncasecmp(name, prefix, strlen(prefix)) == 0) {
+            if (found >= 0) {
+                return -1;
+            }
+            found = i;
+        }
+    }
+    return found;
+}
+
+void profile_switch(int index)
+{
+    if ((index < 0) || (index >= PROFILE_NUM)) {
+        return;
+    }
+
+    bool ir_enabled = chu_cfg->ir.enabled;
+
+    profile_store(&store->profiles[store->active]);
+    store->active = index;
+    profile_load(&store->profiles[index]);
+
+    /* only registers that differ are written */
+    slider_update_config();
+    report_nkro_keymap(chu_cfg->nkro.keymap);
+    /* IR and ToF use different pins and buses, bring up whichever is on now */
+    if (chu_cfg->ir.enabled != ir_enabled) {
+        air_init();
+    }
+    config_changed();
+}
+
+void profile_next()
+{
+    profile_switch((store->active + 1) % PROFILE_NUM);
+}
+
+bool profile_rename(const char *name)
+{
+    size_t len = strlen(name);
+    if ((len == 0) || (len >= PROFILE_NAME_LEN)) {
+        return false;
+    }
+    for (int i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)name[i]) && (name[i] != '-') && (name[i] != '_')) {
+            return false;
+        }
+    }
+    for (int i = 0; i < PROFILE_NUM; i++) {
+        if ((i != store->active) && (strcasecmp(store->profiles[i].name, name) == 0)) {
+            return false;
+        }
+    }
+
+    profile_t *profile = &store->profiles[store->active];
+    memset(profile->name, 0, sizeof(profile->name));
+    memcpy(profile->name, name, len);
+    config_changed();
+    return true;
+}
+
+void profile_reset()
+{
+    for (int i = 0; i < PROFILE_NUM; i++) {
+        profile_fill(i);
+    }
+    store->active = 0;
+    config_changed();
+}
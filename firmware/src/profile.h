@@ -0,0 +1,29 @@
+/*
+ * Config Profiles
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PROFILE_NUM 4
+#define PROFILE_NAME_LEN 8
+
+void profile_init();
+
+int profile_active();
+const char *profile_name(int index);
+/* index of the profile whose name starts with prefix, -1 if none or ambiguous */
+int profile_find(const char *prefix);
+
+/* Live settings go back to the current profile, then the new one takes over */
+void profile_switch(int index);
+void profile_next();
+bool profile_rename(const char *name);
+/* All profiles become copies of the live settings */
+void profile_reset();
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * HID Report Generation
+ * WHowe <github.com/whowechina>
+ *
+ * Pure input-to-report packing, kept free of SDK hardware dependencies.
+ */
+
+#include "report.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "class/hid/hid.h"
+
+/* to cope with Redboard mapping which I don't really understand why */
+#define AIR_REMAP(a) ((((a) >> 1) & 0x07) | (((a) & 0x01) << 3) | ((a) & 0x30))
+#define AIR_REMAP4(a) AIR_REMAP(a), AIR_REMAP(a + 1), AIR_REMAP(a + 2), AIR_REMAP(a + 3)
+#define AIR_REMAP16(a) AIR_REMAP4(a), AIR_REMAP4(a + 4), AIR_REMAP4(a + 8), AIR_REMAP4(a + 12)
+
+static const uint8_t air_buttons[64] = {
+    AIR_REMAP16(0), AIR_REMAP16(16), AIR_REMAP16(32), AIR_REMAP16(48)
+};
+
+/* bit 0: START, bit 1: SERVICE, bit 2: TEST */
+static const uint16_t aux_buttons[8] = {
+    0x0000, 0x0200, 0x0100, 0x0300, 0x1000, 0x1200, 0x1100, 0x1300
+};
+
+/* Reverse the order of the 16 key pairs, keeping the order inside a pair */
+static inline uint32_t reverse_pairs(uint32_t x)
+{
+    x = (x >> 16) | (x << 16);
+    x = ((x & 0xff00ff00) >> 8) | ((x & 0x00ff00ff) << 8);
+    x = ((x & 0xf0f0f0f0) >> 4) | ((x & 0x0f0f0f0f) << 4);
+    x = ((x & 0xcccccccc) >> 2) | ((x & 0x33333333) << 2);
+    return x;
+}
+
+void report_gen_joy(hid_joy_t *joy, uint32_t touched, uint8_t airmap, uint16_t aux)
+{
+    joy->axis = reverse_pairs(touched) ^ 0x80808080; // some magic number from CrazyRedMachine
+    joy->buttons = air_buttons[airmap & 0x3f] | aux_buttons[aux & 0x07];
+}
+
+static const uint8_t keycode_table[128][2] = { HID_ASCII_TO_KEYCODE };
+
+/* Where each input lands in the NKRO bitmap, built once per keymap change */
+static struct {
+    uint8_t byte;
+    uint8_t mask;
+} nkro_table[NKRO_KEY_NUM];
+
+void report_nkro_keymap(const char *keys)
+{
+    for (int i = 0; i < NKRO_KEY_NUM; i++) {
+        uint8_t ascii = keys[i] & 0x7f;
+        uint8_t code = keycode_table[ascii][1];
+        if (code / 8 >= sizeof(((hid_nkro_t *)0)->keymap)) {
+            code = 0;
+        }
+        nkro_table[i].byte = code / 8;
+        nkro_table[i].mask = 1 << (code % 8);
+    }
+}
+
+void report_gen_nkro(hid_nkro_t *nkro, uint32_t touched, uint8_t airmap, uint16_t aux)
+{
+    uint64_t inputs = touched | ((uint64_t)(airmap & 0x3f) << 32) |
+                      ((uint64_t)(aux & 0x07) << 38);
+
+    uint8_t keymap[sizeof(nkro->keymap)] = { 0 };
+    for (int i = 0; i < NKRO_KEY_NUM; i++) {
+        uint8_t on = -(uint8_t)((inputs >> i) & 1);
+        keymap[nkro_table[i].byte] |= nkro_table[i].mask & on;
+    }
+    memcpy(nkro->keymap, keymap, sizeof(keymap));
+}
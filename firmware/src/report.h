@@ -0,0 +1,33 @@
+/*
+ * HID Report Generation
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct __attribute__((packed)) {
+    uint16_t buttons; // 16 buttons; see JoystickButtons_t for bit mapping
+    uint8_t  HAT;    // HAT switch; one nibble w/ unused nibble
+    uint32_t axis;  // slider touch data
+    uint8_t  VendorSpec;
+} hid_joy_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t modifier;
+    uint8_t keymap[15];
+} hid_nkro_t;
+
+#define NKRO_KEY_NUM 41 // 32 keys, 6 air keys, 3 aux
+
+/* keys: one ASCII char for each NKRO input, rebuilds the lookup table */
+void report_nkro_keymap(const char *keys);
+
+/* touched: bit n is slider pad n, airmap: 6 air keys, aux: 3 buttons */
+void report_gen_joy(hid_joy_t *joy, uint32_t touched, uint8_t airmap, uint16_t aux);
+void report_gen_nkro(hid_nkro_t *nkro, uint32_t touched, uint8_t airmap, uint16_t aux);
+
+#endif
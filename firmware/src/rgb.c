@@ -12,15 +12,58 @@
 #include <stdbool.h>
 
 #include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 #include "hardware/timer.h"
+#include "hardware/sync.h"
 
 #include "ws2812.pio.h"
 
 #include "board_defs.h"
 #include "config.h"
+#include "lzfx.h"
 
+/* LED words are kept the way PIO wants them: 24-bit color << 8 */
 static uint32_t buf_main[47]; // 16(Keys) + 15(Gaps) + 16 (ToF/Tower indicators)
-static const uint32_t *buf_tower = &buf_main[31];
+
+/* what actually goes out to the PIO state machines, fed by DMA */
+static uint32_t frame_main[31 + 16 + 6];
+static uint32_t frame_tower[6];
+static int dma_main;
+static int dma_tower;
+static volatile uint32_t dma_pending;
+
+/* LEDs changed since last sent out, bit n is buf_main[n] */
+static uint64_t dirty;
+#define DIRTY_ALL ((1ULL << count_of(buf_main)) - 1)
+
+/* Host frames are written by core 0 (USB) and sent from here by core 1.
+   seq is odd while core 0 is writing, core 1 acks the seq it has taken,
+   dirty piles up until an acked frame, so merged frames lose nothing. */
+static struct {
+    volatile uint32_t seq;
+    volatile uint32_t ack;
+    uint64_t dirty;
+    uint32_t leds[count_of(buf_main)];
+} host_frame;
+
+/* LEDs last written by the host, these go out from host_frame, not buf_main */
+static uint64_t host_owned;
+
+static volatile uint32_t host_frames; // only core 0 counts this
+static uint64_t host_time;
+
+/* full rate while host is streaming, slower for local effects */
+#define LED_HOST_FRAME_US 4000
+#define LED_IDLE_FRAME_US 16000
+#define LED_HOST_IDLE_US 1000000
+/* resend even if nothing changed, in case a strip missed something */
+#define LED_KEEPALIVE_US 1000000
+/* 24 bits at 800kHz, plus the reset gap after a frame */
+#define LED_WORD_US 30
+#define LED_RESET_US 280
+
+static rgb_stat_t stat, stat_last;
 
 #define _MAP_LED(x) _MAKE_MAPPER(x)
 #define _MAKE_MAPPER(x) MAP_LED_##x
@@ -30,12 +73,37 @@ static const uint32_t *buf_tower = &buf_main[31];
 #define REMAP_BUTTON_RGB _MAP_LED(BUTTON_RGB_ORDER)
 #define REMAP_TT_RGB _MAP_LED(TT_RGB_ORDER)
 
+/* Where r, g and b sit in a 24-bit LED word, channel 0 goes out first */
+#if BUTTON_RGB_ORDER == GRB
+#define CHN_R 1
+#define CHN_G 0
+#else
+#define CHN_R 0
+#define CHN_G 1
+#endif
+#define CHN_B 2
+#define CHN_SHIFT(chn) (24 - (chn) * 8) // straight into PIO layout
+
+static uint8_t gamma_lut[256];
+
+/* level and color fix folded together, per LED group and channel */
+enum { GROUP_KEY, GROUP_GAP, GROUP_TOWER, GROUP_NUM };
+static uint8_t level_lut[GROUP_NUM][3][256];
+
+static inline unsigned led_group(unsigned index)
+{
+    if (index >= 31) {
+        return GROUP_TOWER;
+    }
+    return (index & 1) ? GROUP_GAP : GROUP_KEY;
+}
+
 static inline uint32_t _rgb32(uint32_t c1, uint32_t c2, uint32_t c3, bool gamma_fix)
 {
     if (gamma_fix) {
-        c1 = ((c1 + 1) * (c1 + 1) - 1) >> 8;
-        c2 = ((c2 + 1) * (c2 + 1) - 1) >> 8;
-        c3 = ((c3 + 1) * (c3 + 1) - 1) >> 8;
+        c1 = gamma_lut[c1 & 0xff];
+        c2 = gamma_lut[c2 & 0xff];
+        c3 = gamma_lut[c3 & 0xff];
     }
     
     return (c1 << 16) | (c2 << 8) | (c3 << 0);    
@@ -81,30 +149,128 @@ uint32_t rgb32_from_hsv(uint8_t h, uint8_t s, uint8_t v)
     }
 }
 
+static void __isr led_dma_irq()
+{
+    if (dma_channel_get_irq0_status(dma_main)) {
+        dma_channel_acknowledge_irq0(dma_main);
+        dma_pending &= ~(1u << dma_main);
+    }
+    if (dma_channel_get_irq0_status(dma_tower)) {
+        dma_channel_acknowledge_irq0(dma_tower);
+        dma_pending &= ~(1u << dma_tower);
+    }
+}
+
+/* Where LEDs first to first + num - 1 go out from. That's one side as
+   long as the host is streaming or idle, both only get merged if mixed. */
+static const uint32_t *led_source(uint64_t owned, unsigned first, unsigned num)
+{
+    uint64_t range = ((1ULL << num) - 1) << first;
+    if ((owned & range) == range) {
+        return host_frame.leds;
+    }
+    if (!(owned & range)) {
+        return buf_main;
+    }
+
+    static uint32_t mixed[count_of(buf_main)];
+    for (int i = first; i < first + num; i++) {
+        mixed[i] = (owned & (1ULL << i)) ? host_frame.leds[i] : buf_main[i];
+    }
+    return mixed;
+}
+
 static void drive_led()
 {
     static uint64_t last = 0;
     uint64_t now = time_us_64();
-    if (now - last < 4000) { // no faster than 250Hz
+    bool streaming = (now - host_time < LED_HOST_IDLE_US);
+    if (now - last < (streaming ? LED_HOST_FRAME_US : LED_IDLE_FRAME_US)) {
+        return;
+    }
+    static bool skip_split = false;
+    if (skip_split != chu_cfg->tweak.skip_split_led) {
+        skip_split = chu_cfg->tweak.skip_split_led;
+        dirty = DIRTY_ALL;
+    }
+    if (dma_pending) { // last frame still going out
+        return;
+    }
+    if (!dirty && (now - last < LED_KEEPALIVE_US)) {
+        stat.skipped++;
         return;
     }
-    last = now;
 
+    /* host words are read straight from the host frame, same seqlock */
+    uint32_t seq = host_frame.seq;
+    if (host_owned && (seq & 1)) { // core 0 is on it, send next time
+        return;
+    }
+    __dmb();
+
+    /* keys and gaps, tower, then the rest, each usually from one side */
+    const uint32_t *src = led_source(host_owned, 0, 31);
+    unsigned len = 0;
     for (int i = 30; i >= 0; i--) {
-        if (chu_cfg->tweak.skip_split_led && (i % 2 == 1)) {
+        if (skip_split && (i % 2 == 1)) {
             continue;
         }
-        pio_sm_put_blocking(pio0, 0, buf_main[i] << 8u);
+        frame_main[len++] = src[i];
     }
-    for (int i = 31; i < count_of(buf_main); i++) {
-        pio_sm_put_blocking(pio0, 0, buf_main[i] << 8u);
+    src = led_source(host_owned, 31, 6);
+    memcpy(frame_tower, &src[31], sizeof(frame_tower));
+    memcpy(&frame_main[len], frame_tower, sizeof(frame_tower));
+    len += count_of(frame_tower);
+    src = led_source(host_owned, 37, count_of(buf_main) - 37);
+    for (int i = 37; i < count_of(buf_main); i++) {
+        frame_main[len++] = src[i];
     }
+    memcpy(&frame_main[len], frame_tower, sizeof(frame_tower));
+    len += count_of(frame_tower);
 
-    for (int i = 0; i < 6; i++) {
-        pio_sm_put_blocking(pio0, 0, buf_tower[i] << 8u);
+    __dmb();
+    if (host_owned && (host_frame.seq != seq)) { // torn, send next time
+        return;
     }
-    for (int i = 0; i < 6; i++) {
-        pio_sm_put_blocking(pio0, 1, buf_tower[i] << 8u);
+    if (!dirty) {
+        stat.keepalive++;
+    }
+    last = now;
+    dirty = 0;
+
+    dma_channel_set_read_addr(dma_main, frame_main, false);
+    dma_channel_set_trans_count(dma_main, len, false);
+    dma_channel_set_read_addr(dma_tower, frame_tower, false);
+    dma_channel_set_trans_count(dma_tower, count_of(frame_tower), false);
+
+    dma_pending = (1u << dma_main) | (1u << dma_tower);
+    dma_start_channel_mask(dma_pending);
+
+    stat.sent++;
+    stat.bus_us += len * LED_WORD_US + LED_RESET_US;
+}
+
+static int led_dma_init(unsigned sm)
+{
+    int chn = dma_claim_unused_channel(true);
+    dma_channel_config cfg = dma_channel_get_default_config(chn);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, pio_get_dreq(pio0, sm, true));
+    dma_channel_configure(chn, &cfg, &pio0->txf[sm], NULL, 0, false);
+    dma_channel_set_irq0_enabled(chn, true);
+    return chn;
+}
+
+/* a local write takes the LED back from the host */
+static inline void set_led(unsigned index, uint32_t color)
+{
+    uint64_t bit = 1ULL << index;
+    if ((buf_main[index] != color) || (host_owned & bit)) {
+        buf_main[index] = color;
+        host_owned &= ~bit;
+        dirty |= bit;
     }
 }
 
@@ -116,20 +282,36 @@ void rgb_set_colors(const uint32_t *colors, unsigned index, size_t num)
     if (index + num > count_of(buf_main)) {
         num = count_of(buf_main) - index;
     }
-    memcpy(&buf_main[index], colors, num * sizeof(*colors));
+    for (int i = 0; i < num; i++) {
+        set_led(index + i, colors[i] << 8u);
+    }
 }
 
-static inline uint32_t apply_level(uint32_t color)
+void rgb_update_level()
 {
-    unsigned r = (color >> 16) & 0xff;
-    unsigned g = (color >> 8) & 0xff;
-    unsigned b = color & 0xff;
+    const uint8_t *fix[GROUP_NUM] = {
+        chu_cfg->color_fix.key, chu_cfg->color_fix.gap, chu_cfg->color_fix.tower
+    };
+    const int chn[3] = { CHN_R, CHN_G, CHN_B };
+    uint32_t level = chu_cfg->style.level;
 
-    r = r * chu_cfg->style.level / 255;
-    g = g * chu_cfg->style.level / 255;
-    b = b * chu_cfg->style.level / 255;
+    for (int i = 0; i < GROUP_NUM; i++) {
+        for (int c = 0; c < 3; c++) {
+            uint32_t scale = level * fix[i][c];
+            for (int v = 0; v < 256; v++) {
+                level_lut[i][chn[c]][v] = v * scale / (255 * 255);
+            }
+        }
+    }
+}
 
-    return r << 16 | g << 8 | b;
+/* 24-bit color in, PIO ready LED word out */
+static inline uint32_t apply_level(unsigned group, uint32_t color)
+{
+    const uint8_t (*lut)[256] = level_lut[group];
+    return lut[0][(color >> 16) & 0xff] << CHN_SHIFT(0) |
+           lut[1][(color >> 8) & 0xff] << CHN_SHIFT(1) |
+           lut[2][color & 0xff] << CHN_SHIFT(2);
 }
 
 void rgb_set_color(unsigned index, uint32_t color)
@@ -137,7 +319,7 @@ void rgb_set_color(unsigned index, uint32_t color)
     if (index >= count_of(buf_main)) {
         return;
     }
-    buf_main[index] = apply_level(color);
+    set_led(index, apply_level(led_group(index), color));
 }
 
 void rgb_key_color(unsigned index, uint32_t color)
@@ -145,7 +327,7 @@ void rgb_key_color(unsigned index, uint32_t color)
     if (index > 16) {
         return;
     }
-    buf_main[index * 2] = apply_level(color);
+    set_led(index * 2, apply_level(GROUP_KEY, color));
 }
 
 void rgb_gap_color(unsigned index, uint32_t color)
@@ -153,23 +335,132 @@ void rgb_gap_color(unsigned index, uint32_t color)
     if (index > 15) {
         return;
     }
-    buf_main[index * 2 + 1] = apply_level(color);
+    set_led(index * 2 + 1, apply_level(GROUP_GAP, color));
 }
 
-void rgb_set_brg(unsigned index, const uint8_t *brg_array, size_t num)
+static uint8_t host_brg[(48 + 45 + 6) * 3];
+
+bool rgb_set_brg_lzfx(const uint8_t *data, unsigned len)
+{
+    unsigned olen = sizeof(host_brg);
+    if (lzfx_decompress(data, len, host_brg, &olen) != 0) {
+        return false;
+    }
+    rgb_set_brg(0, host_brg, olen / 3);
+    return true;
+}
+
+/* Host writes go into the host frame between host_begin() and host_end() */
+static uint32_t host_begin()
+{
+    uint32_t seq = host_frame.seq;
+    host_frame.seq = seq + 1;
+    __dmb();
+    return seq;
+}
+
+static uint64_t host_put(unsigned index, const uint8_t *brg_array, size_t num)
 {
     if (index >= count_of(buf_main)) {
-        return;
+        return 0;
     }
     if (index + num > count_of(buf_main)) {
         num = count_of(buf_main) - index;
     }
+
+    uint32_t *leds = &host_frame.leds[index];
     for (int i = 0; i < num; i++) {
-        uint8_t b = brg_array[i * 3 + 0];
-        uint8_t r = brg_array[i * 3 + 1];
-        uint8_t g = brg_array[i * 3 + 2];
-        buf_main[index + i] = apply_level(rgb32(r, g, b, false));
+        const uint8_t (*lut)[256] = level_lut[led_group(index + i)];
+        uint8_t b = brg_array[0];
+        uint8_t r = brg_array[1];
+        uint8_t g = brg_array[2];
+        brg_array += 3;
+        leds[i] = lut[CHN_R][r] << CHN_SHIFT(CHN_R) |
+                  lut[CHN_G][g] << CHN_SHIFT(CHN_G) |
+                  lut[CHN_B][b] << CHN_SHIFT(CHN_B);
+    }
+
+    return ((1ULL << num) - 1) << index;
+}
+
+static void host_end(uint32_t seq, uint64_t mask)
+{
+    if (host_frame.ack == seq) {
+        host_frame.dirty = mask;
+    } else {
+        host_frame.dirty |= mask;
+    }
+
+    __dmb();
+    host_frame.seq = seq + 2;
+    host_frames++;
+}
+
+void rgb_set_brg(unsigned index, const uint8_t *brg_array, size_t num)
+{
+    if (index >= count_of(buf_main)) {
+        return;
+    }
+    uint32_t seq = host_begin();
+    host_end(seq, host_put(index, brg_array, num));
+}
+
+bool rgb_set_brg_delta(const uint8_t *data, size_t len)
+{
+    uint32_t seq = host_begin();
+    uint64_t mask = 0;
+    bool ok = true;
+
+    while (len >= 2) {
+        uint8_t index = data[0];
+        uint8_t num = data[1];
+        if ((num == 0) || (len < 2 + num * 3)) {
+            ok = (num == 0); // zero length run ends it early
+            break;
+        }
+        mask |= host_put(index, data + 2, num);
+        data += 2 + num * 3;
+        len -= 2 + num * 3;
     }
+
+    host_end(seq, mask);
+    return ok;
+}
+
+static void pull_host()
+{
+    uint32_t seq = host_frame.seq;
+    uint32_t ack = host_frame.ack;
+    if ((seq == ack) || (seq & 1)) { // nothing new, or core 0 is on it
+        return;
+    }
+
+    __dmb();
+    uint64_t mask = host_frame.dirty;
+    __dmb();
+
+    if (host_frame.seq != seq) { // torn, take it next time
+        return;
+    }
+    host_frame.ack = seq;
+    host_time = time_us_64();
+    stat.host_merged += (seq - ack) / 2 - 1;
+
+    /* no copy here, drive_led() reads these LEDs from the host frame */
+    host_owned |= mask;
+    dirty |= mask;
+}
+
+void rgb_pull_host()
+{
+    uint32_t start = time_us_32();
+    pull_host();
+    stat.cpu_us += time_us_32() - start;
+}
+
+void rgb_stat(rgb_stat_t *out)
+{
+    *out = stat_last;
 }
 
 void rgb_init()
@@ -178,9 +469,33 @@ void rgb_init()
     ws2812_program_init(pio0, 0, offset, RGB_MAIN_PIN, 800000, false);
     ws2812_program_init(pio0, 1, offset, RGB_TOWER_LEFT_PIN, 800000, false);
     ws2812_program_init(pio0, 2, offset, RGB_TOWER_RIGHT_PIN, 800000, false);
+
+    for (int i = 0; i < 256; i++) {
+        gamma_lut[i] = ((i + 1) * (i + 1) - 1) >> 8;
+    }
+    rgb_update_level();
+
+    dirty = DIRTY_ALL;
+    dma_main = led_dma_init(0);
+    dma_tower = led_dma_init(1);
+    irq_set_exclusive_handler(DMA_IRQ_0, led_dma_irq);
+    irq_set_enabled(DMA_IRQ_0, true);
 }
 
 void rgb_update()
 {
+    static uint32_t last = 0;
+    static uint32_t frames = 0;
+
+    uint32_t now = time_us_32();
+    if (now - last >= 1000000) {
+        last = now;
+        stat.host_frames = host_frames - frames;
+        frames += stat.host_frames;
+        stat_last = stat;
+        memset(&stat, 0, sizeof(stat));
+    }
+
     drive_led();
+    stat.cpu_us += time_us_32() - now;
 }
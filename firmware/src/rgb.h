@@ -15,6 +15,24 @@
 void rgb_init();
 void rgb_update();
 
+/* Take the latest host LED frame (core 1), before drawing local effects */
+void rgb_pull_host();
+/* LED activity over the last second */
+typedef struct {
+    uint32_t host_frames; // host LED reports received
+    uint32_t host_merged; // overwritten before core 1 took them
+    uint32_t sent;        // frames sent out to the strips
+    uint32_t keepalive;   // of which resent with nothing changed
+    uint32_t skipped;     // nothing to send
+    uint32_t cpu_us;      // core 1 time spent on LED output
+    uint32_t bus_us;      // time the main strip was busy
+} rgb_stat_t;
+
+void rgb_stat(rgb_stat_t *stat);
+
+/* Rebuild lookup tables after level or color fix changes */
+void rgb_update_level();
+
 uint32_t rgb32(uint32_t r, uint32_t g, uint32_t b, bool gamma_fix);
 uint32_t rgb32_from_hsv(uint8_t h, uint8_t s, uint8_t v);
 
@@ -23,7 +41,11 @@ void rgb_set_color(unsigned index, uint32_t color);
 void rgb_key_color(unsigned index, uint32_t color);
 void rgb_gap_color(unsigned index, uint32_t color);
 
-/* num of the rgb leds, num*3 bytes in the array */
+/* From host (core 0), num of the rgb leds, num*3 bytes in the array */
 void rgb_set_brg(unsigned index, const uint8_t *brg_array, size_t num);
+/* From host (core 0), runs of [index, num, num*3 brg bytes], padded with 0 */
+bool rgb_set_brg_delta(const uint8_t *data, size_t len);
+/* From host (core 0), lzfx compressed brg array starting at led 0 */
+bool rgb_set_brg_lzfx(const uint8_t *data, unsigned len);
 
 #endif
@@ -2,7 +2,14 @@
  * Controller Config Save and Load
  * WHowe <github.com/whowechina>
  * 
- * Config is stored in last sector of flash
+ * Config is stored as an append-only journal in the last two sectors of
+ * flash, one CRC checked delta entry per save, compacted into the other
+ * sector only when the current one fills up.
+ *
+ * Writing is a job of single flash operations, one per save_loop() call,
+ * so input servicing only ever misses one page program at a time. The
+ * sector erase can't be split like that, the spare sector is erased ahead
+ * of time in a quiet window instead, so compaction doesn't need it.
  */
 
 #include "save.h"
@@ -10,7 +17,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "pico/bootrom.h"
@@ -30,45 +39,436 @@ static int module_num = 0;
 static uint32_t my_magic = 0xcafecafe;
 
 #define SAVE_TIMEOUT_US 5000000
+#define SAVE_QUIET_US 3000000 /* no input for this long before saving */
+#define SAVE_MAX_DEFER_US 60000000 /* saved anyway if pending this long */
+#define IO_SETTLE_US 10000    /* let other I/O finish after taking the lock */
 
-#define SAVE_SECTOR_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+/* Journal lives in the last two sectors, the older firmware used only the
+   last one with whole page copies, it's still read once for migration */
+#define JOURNAL_SECTORS 2
+#define JOURNAL_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE * JOURNAL_SECTORS)
+#define LEGACY_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define JOURNAL_MAGIC_XOR 0x4a524e4c
 
+/* What older firmware wrote, one page each save */
 typedef struct __attribute ((packed)) {
     uint32_t magic;
     uint8_t data[FLASH_PAGE_SIZE - 4];
 } page_t;
 
-static page_t old_data = {0};
-static page_t new_data = {0};
-static page_t default_data = {0};
-static int data_page = -1;
+/* All modules in RAM, the journal doesn't tie it to a page any more */
+#define IMAGE_SIZE (FLASH_PAGE_SIZE * 4)
+typedef struct __attribute ((packed)) {
+    uint32_t magic;
+    uint8_t data[IMAGE_SIZE - 4];
+} image_t;
+
+/* Sector header is programmed last, so a half written sector never counts */
+typedef struct __attribute ((packed)) {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t crc;
+} sector_hdr_t;
+
+/* One save is one entry, so it lands either completely or not at all:
+   entry:  [size lo, size hi, records..., crc lo, crc hi]
+   record: [module, len, offset lo, offset hi, data x len] */
+#define ENTRY_HEAD 2
+#define ENTRY_TAIL 2
+#define ENTRY_END 0xffff  /* erased flash */
+#define REC_HEAD 4
+#define REC_MAX_DATA 255
+#define REC_MERGE_GAP REC_HEAD
+
+static image_t old_data = {0};
+static image_t new_data = {0};
+static image_t default_data = {0};
+
+static struct {
+    int sector;
+    uint32_t seq;
+    uint32_t pos;   /* where the next entry goes */
+    bool broken;    /* a bad entry, no more appending here */
+    bool spare_blank; /* the sector compaction goes to is erased already */
+} journal = { .sector = -1 };
 
 static bool requesting_save = false;
 static uint64_t requesting_time = 0;
+static uint64_t input_time = 0;
+
+typedef enum {
+    JOB_NONE = 0,
+    JOB_SETTLE,
+    JOB_ERASE,
+    JOB_PROGRAM,
+    JOB_HEADER,
+    JOB_DONE,
+} job_step_t;
+
+/* The entry being written sits in rec_buf, the snapshot it was made from
+   becomes old_data once everything is in flash */
+static struct {
+    job_step_t step;
+    bool erase_only; /* the spare sector, no save */
+    bool compact;
+    int sector;
+    uint32_t offset; /* where the entry goes */
+    size_t len;
+    size_t done;
+    sector_hdr_t hdr;
+    uint64_t lock_time;
+    uint32_t stall;  /* longest input gap of this job */
+} job;
+
+/* Input gaps are frame start to frame start, with a flash op in between */
+static uint64_t frame_time;
+static bool frame_flashed;
+
+static image_t saving_data;
+
+static save_stat_t stat;
 
 static mutex_t *io_lock;
 
-static void save_program()
+static uint8_t prog_buf[FLASH_PAGE_SIZE];
+static uint8_t rec_buf[IMAGE_SIZE + FLASH_PAGE_SIZE];
+
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i] << 8;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static inline uint32_t journal_magic()
+{
+    return my_magic ^ JOURNAL_MAGIC_XOR;
+}
+
+static inline uint32_t sector_offset(int sector)
+{
+    return JOURNAL_OFFSET + sector * FLASH_SECTOR_SIZE;
+}
+
+static inline const uint8_t *flash_ptr(uint32_t offset)
+{
+    return (const uint8_t *)(XIP_BASE + offset);
+}
+
+static inline int spare_sector()
 {
-    old_data = new_data;
+    return (journal.sector + 1) % JOURNAL_SECTORS;
+}
 
-    data_page = (data_page + 1) % (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE);
-    printf("\nProgram Flash %d %8lx\n", data_page, old_data.magic);
-    if (mutex_enter_timeout_us(io_lock, 100000)) {
-        sleep_ms(10); /* wait for all io operations to finish */
-        uint32_t ints = save_and_disable_interrupts();
-        if (data_page == 0) {
-            flash_range_erase(SAVE_SECTOR_OFFSET, FLASH_SECTOR_SIZE);
+static bool sector_blank(int sector)
+{
+    const uint8_t *p = flash_ptr(sector_offset(sector));
+    for (int i = 0; i < FLASH_SECTOR_SIZE; i++) {
+        if (p[i] != 0xff) {
+            return false;
         }
-        flash_range_program(SAVE_SECTOR_OFFSET + data_page * FLASH_PAGE_SIZE,
-                            (uint8_t *)&old_data, FLASH_PAGE_SIZE);
-        restore_interrupts(ints);
-        mutex_exit(io_lock);
-    } else {
+    }
+    return true;
+}
+
+static bool lock_io()
+{
+    if (!mutex_enter_timeout_us(io_lock, 100000)) {
         printf("Program Flash Failed.\n");
+        return false;
+    }
+    return true;
+}
+
+static void unlock_io()
+{
+    mutex_exit(io_lock);
+}
+
+/* Program up to one page, untouched bytes of the page are left as 0xff */
+static size_t program_page(uint32_t offset, const uint8_t *data, size_t len)
+{
+    uint32_t page = offset & ~(FLASH_PAGE_SIZE - 1);
+    uint32_t in_page = offset - page;
+    size_t n = FLASH_PAGE_SIZE - in_page;
+    if (n > len) {
+        n = len;
+    }
+
+    memset(prog_buf, 0xff, sizeof(prog_buf));
+    memcpy(prog_buf + in_page, data, n);
+
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_program(page, prog_buf, FLASH_PAGE_SIZE);
+    restore_interrupts(ints);
+
+    return n;
+}
+
+static void erase_sector(uint32_t offset)
+{
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(offset, FLASH_SECTOR_SIZE);
+    restore_interrupts(ints);
+}
+
+static size_t put_record(uint8_t *rec, int module, size_t offset,
+                         const uint8_t *data, size_t len)
+{
+    rec[0] = module;
+    rec[1] = len;
+    rec[2] = offset & 0xff;
+    rec[3] = offset >> 8;
+    memcpy(rec + REC_HEAD, data, len);
+    return REC_HEAD + len;
+}
+
+/* Records are already in rec_buf after the head, fill in head and tail */
+static size_t seal_entry(size_t size)
+{
+    rec_buf[0] = size & 0xff;
+    rec_buf[1] = size >> 8;
+    uint16_t crc = crc16(rec_buf, ENTRY_HEAD + size);
+    rec_buf[ENTRY_HEAD + size] = crc & 0xff;
+    rec_buf[ENTRY_HEAD + size + 1] = crc >> 8;
+    return ENTRY_HEAD + size + ENTRY_TAIL;
+}
+
+static void apply_records(const uint8_t *rec, size_t size)
+{
+    while (size >= REC_HEAD) {
+        int module = rec[0];
+        size_t len = rec[1];
+        size_t offset = rec[2] | (rec[3] << 8);
+        if (REC_HEAD + len > size) {
+            return;
+        }
+        if ((module < module_num) && (offset < modules[module].size)) {
+            size_t n = len;
+            if (offset + n > modules[module].size) {
+                n = modules[module].size - offset;
+            }
+            memcpy(new_data.data + modules[module].offset + offset,
+                   rec + REC_HEAD, n);
+        }
+        rec += REC_HEAD + len;
+        size -= REC_HEAD + len;
+    }
+}
+
+static bool sector_valid(int sector, uint32_t *seq)
+{
+    sector_hdr_t hdr;
+    memcpy(&hdr, flash_ptr(sector_offset(sector)), sizeof(hdr));
+    if ((hdr.magic != journal_magic()) ||
+        (hdr.crc != crc16((uint8_t *)&hdr, offsetof(sector_hdr_t, crc)))) {
+        return false;
+    }
+    *seq = hdr.seq;
+    return true;
+}
+
+/* Replay all good entries of a sector onto new_data */
+static void replay_sector(int sector)
+{
+    uint32_t base = sector_offset(sector);
+    uint32_t pos = sizeof(sector_hdr_t);
+
+    journal.broken = false;
+    while (pos + ENTRY_HEAD + ENTRY_TAIL <= FLASH_SECTOR_SIZE) {
+        const uint8_t *entry = flash_ptr(base + pos);
+        size_t size = entry[0] | (entry[1] << 8);
+        if (size == ENTRY_END) {
+            break; /* clean end */
+        }
+        size_t total = ENTRY_HEAD + size + ENTRY_TAIL;
+        if ((pos + total > FLASH_SECTOR_SIZE) ||
+            (crc16(entry, ENTRY_HEAD + size) !=
+             (entry[ENTRY_HEAD + size] | (entry[ENTRY_HEAD + size + 1] << 8)))) {
+            journal.broken = true;
+            break;
+        }
+        apply_records(entry + ENTRY_HEAD, size);
+        pos += total;
+    }
+    journal.pos = pos;
+}
+
+/* Whole data into the other sector, which becomes the current one */
+static void prepare_compact()
+{
+    size_t size = 0;
+    for (int i = 0; i < module_num; i++) {
+        for (size_t done = 0; done < modules[i].size; ) {
+            size_t len = modules[i].size - done;
+            if (len > REC_MAX_DATA) {
+                len = REC_MAX_DATA;
+            }
+            size += put_record(rec_buf + ENTRY_HEAD + size, i, done,
+                               saving_data.data + modules[i].offset + done, len);
+            done += len;
+        }
+    }
+
+    job.compact = true;
+    job.sector = spare_sector();
+    job.offset = sector_offset(job.sector) + sizeof(sector_hdr_t);
+    job.len = seal_entry(size);
+
+    job.hdr = (sector_hdr_t) { .magic = journal_magic(), .seq = journal.seq + 1 };
+    job.hdr.crc = crc16((uint8_t *)&job.hdr, offsetof(sector_hdr_t, crc));
+}
+
+/* Only the changed bytes, false if they don't fit in current sector */
+static bool prepare_append()
+{
+    if ((journal.sector < 0) || journal.broken) {
+        return false;
+    }
+
+    const size_t room = sizeof(rec_buf) - ENTRY_HEAD - ENTRY_TAIL;
+    size_t size = 0;
+    for (int i = 0; i < module_num; i++) {
+        const uint8_t *old = old_data.data + modules[i].offset;
+        const uint8_t *new = saving_data.data + modules[i].offset;
+        size_t end = modules[i].size;
+
+        for (size_t pos = 0; pos < end; pos++) {
+            if (old[pos] == new[pos]) {
+                continue;
+            }
+            /* a run of changes, small gaps are cheaper than a new record */
+            size_t last = pos;
+            for (size_t j = pos + 1; (j < end) && (j - pos < REC_MAX_DATA) &&
+                                     (j - last <= REC_MERGE_GAP); j++) {
+                if (old[j] != new[j]) {
+                    last = j;
+                }
+            }
+            size_t len = last - pos + 1;
+            if (size + REC_HEAD + len > room) {
+                return false;
+            }
+            size += put_record(rec_buf + ENTRY_HEAD + size, i, pos, new + pos, len);
+            pos = last;
+        }
+    }
+    size = seal_entry(size);
+
+    if (journal.pos + size > FLASH_SECTOR_SIZE) {
+        return false;
+    }
+
+    job.compact = false;
+    job.sector = journal.sector;
+    job.offset = sector_offset(journal.sector) + journal.pos;
+    job.len = size;
+    return true;
+}
+
+/* Caller holds the io lock, it's released when the job is done */
+static void job_start()
+{
+    saving_data = new_data;
+    if (!prepare_append()) {
+        prepare_compact();
+    }
+    job.erase_only = false;
+    job.done = 0;
+    job.stall = 0;
+    job.lock_time = time_us_64();
+    job.step = JOB_SETTLE;
+}
+
+/* Same as a save, the lock is held until it's done */
+static void erase_start()
+{
+    job.erase_only = true;
+    job.sector = spare_sector();
+    job.stall = 0;
+    job.lock_time = time_us_64();
+    job.step = JOB_SETTLE;
+}
+
+static void job_finish()
+{
+    job.step = JOB_NONE;
+    if (job.erase_only) {
+        unlock_io();
+        return;
+    }
+
+    if (job.compact) {
+        journal.sector = job.sector;
+        journal.seq = job.hdr.seq;
+        journal.pos = sizeof(sector_hdr_t) + job.len;
+        journal.broken = false;
+        journal.spare_blank = false; /* the old sector, erased when quiet */
+        printf("\nJournal Compacted %d %" PRIu32 "\n", journal.sector, journal.seq);
+    } else {
+        printf("\nJournal Appended %d %" PRIu32 "+%zu\n", journal.sector, journal.pos, job.len);
+        journal.pos += job.len;
+    }
+    old_data = saving_data;
+    unlock_io();
+
+    stat.saves++;
+}
+
+/* At most one flash operation per call. Only the sector erase doesn't fit
+   in a frame, it's mostly done ahead by erase_start() when input is quiet.
+   A compaction still erases if no quiet window came since the last one. */
+static void job_run()
+{
+    uint64_t start = time_us_64();
+
+    switch (job.step) {
+        case JOB_SETTLE:
+            if (start - job.lock_time < IO_SETTLE_US) {
+                return;
+            }
+            if (job.erase_only || (job.compact && !journal.spare_blank)) {
+                job.step = JOB_ERASE;
+            } else {
+                job.step = JOB_PROGRAM;
+            }
+            return;
+        case JOB_ERASE:
+            erase_sector(sector_offset(job.sector));
+            journal.spare_blank = true;
+            job.step = job.erase_only ? JOB_DONE : JOB_PROGRAM;
+            break;
+        case JOB_PROGRAM:
+            job.done += program_page(job.offset + job.done, rec_buf + job.done,
+                                     job.len - job.done);
+            if (job.done >= job.len) {
+                job.step = job.compact ? JOB_HEADER : JOB_DONE;
+            }
+            break;
+        case JOB_HEADER:
+            program_page(sector_offset(job.sector), (uint8_t *)&job.hdr,
+                         sizeof(job.hdr));
+            job.step = JOB_DONE;
+            break;
+        default:
+            return;
+    }
+
+    stat.flash_ops++;
+    frame_flashed = true;
+
+    if (job.step == JOB_DONE) {
+        job_finish();
     }
 }
 
+
+
 static void load_default()
 {
     printf("Load Default\n");
@@ -76,30 +476,69 @@ static void load_default()
     new_data.magic = my_magic;
 }
 
-static const page_t *get_page(int id)
+static const page_t *get_legacy_page(int id)
 {
-    int addr = XIP_BASE + SAVE_SECTOR_OFFSET;
-    return (page_t *)(addr + FLASH_PAGE_SIZE * id);
+    return (const page_t *)flash_ptr(LEGACY_OFFSET + FLASH_PAGE_SIZE * id);
 }
 
-static void save_load()
+/* Config saved by older firmware, whole pages in the last sector */
+static bool load_legacy()
 {
+    int data_page = -1;
     for (int i = 0; i < FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE; i++) {
-        if (get_page(i)->magic != my_magic) {
+        if (get_legacy_page(i)->magic != my_magic) {
             break;
         }
         data_page = i;
     }
 
     if (data_page < 0) {
-        load_default();
-        save_request(false);
+        return false;
+    }
+
+    /* modules added since then start from default */
+    const page_t *page = get_legacy_page(data_page);
+    new_data = default_data;
+    new_data.magic = page->magic;
+    for (int i = 0; i < module_num; i++) {
+        if (modules[i].offset + modules[i].size <= sizeof(page->data)) {
+            memcpy(new_data.data + modules[i].offset,
+                   page->data + modules[i].offset, modules[i].size);
+        }
+    }
+    printf("Legacy Page Loaded %d %8" PRIx32 "\n", data_page, new_data.magic);
+    return true;
+}
+
+static void save_load()
+{
+    uint32_t seq[JOURNAL_SECTORS];
+    for (int i = 0; i < JOURNAL_SECTORS; i++) {
+        if (!sector_valid(i, &seq[i])) {
+            continue;
+        }
+        if ((journal.sector < 0) || ((int32_t)(seq[i] - journal.seq) > 0)) {
+            journal.sector = i;
+            journal.seq = seq[i];
+        }
+    }
+
+    if (journal.sector >= 0) {
+        new_data = default_data;
+        new_data.magic = my_magic;
+        replay_sector(journal.sector);
+        old_data = new_data;
+        journal.spare_blank = sector_blank(spare_sector());
+        printf("Journal Loaded %d %" PRIu32 "\n", journal.sector, journal.pos);
         return;
     }
 
-    old_data = *get_page(data_page);
-    new_data = old_data;
-    printf("Page Loaded %d %8lx\n", data_page, new_data.magic);
+    journal.spare_blank = sector_blank(spare_sector());
+    if (!load_legacy()) {
+        load_default();
+    }
+    /* old_data stays blank, so the first save always goes out */
+    save_request(false);
 }
 
 static void save_loaded()
@@ -141,20 +580,95 @@ void save_init(uint32_t magic, mutex_t *locker)
 
 void save_loop()
 {
-    if (requesting_save && (time_us_64() - requesting_time > SAVE_TIMEOUT_US)) {
-        requesting_save = false;
-        /* only when data is actually changed */
-        if (memcmp(&old_data, &new_data, sizeof(old_data)) == 0) {
-            return;
+    if (job.step != JOB_NONE) {
+        job_run();
+        return;
+    }
+
+    uint64_t now = time_us_64();
+    bool quiet = (now - input_time > SAVE_QUIET_US);
+    if (!journal.spare_blank && quiet) {
+        if (mutex_try_enter(io_lock, NULL)) {
+            erase_start();
         }
-        save_program();
+        return;
+    }
+
+    if (!requesting_save || (now - requesting_time <= SAVE_TIMEOUT_US)) {
+        return;
+    }
+    /* endless play shouldn't keep a change from ever reaching the flash */
+    if (!quiet && (now - requesting_time <= SAVE_MAX_DEFER_US)) {
+        return;
+    }
+    /* only when data is actually changed */
+    if (memcmp(&old_data, &new_data, sizeof(old_data)) == 0) {
+        requesting_save = false;
+        return;
+    }
+    /* core 1 may be in the middle of something, try again next time */
+    if (mutex_try_enter(io_lock, NULL)) {
+        requesting_save = false;
+        job_start();
     }
 }
 
+/* Everything at once, for when the caller asked for it */
+static void save_flush()
+{
+    while (job.step != JOB_NONE) {
+        job_run();
+    }
+
+    if (memcmp(&old_data, &new_data, sizeof(old_data)) == 0) {
+        requesting_save = false;
+        return;
+    }
+    if (!lock_io()) {
+        return;
+    }
+    requesting_save = false;
+    job_start();
+    while (job.step != JOB_NONE) {
+        job_run();
+    }
+}
+
+void save_hold()
+{
+    input_time = time_us_64();
+}
+
+void save_frame()
+{
+    uint64_t now = time_us_64();
+    if (frame_flashed) {
+        frame_flashed = false;
+        uint32_t gap = now - frame_time;
+        job.stall = gap > job.stall ? gap : job.stall;
+        stat.last_stall_us = job.stall;
+        stat.max_stall_us = gap > stat.max_stall_us ? gap : stat.max_stall_us;
+    }
+    frame_time = now;
+}
+
+void save_stat(save_stat_t *out)
+{
+    *out = stat;
+}
+
 void *save_alloc(size_t size, void *def, void (*after_load)())
 {
+    size_t offset = 0;
+    if (module_num > 0) {
+        offset = modules[module_num - 1].offset + modules[module_num - 1].size;
+    }
+    if ((module_num >= count_of(modules)) ||
+        (offset + size > sizeof(new_data.data))) {
+        printf("Save module %d doesn't fit.\n", module_num);
+        return NULL;
+    }
     modules[module_num].size = size;
-    size_t offset = module_num > 0 ? modules[module_num - 1].offset + size : 0;
     modules[module_num].offset = offset;
     modules[module_num].after_load = after_load;
     module_num++;
@@ -171,7 +685,6 @@ void save_request(bool immediately)
         requesting_time = time_us_64();
     }
     if (immediately) {
-        requesting_time = 0;
-        save_loop();
+        save_flush();
     }
 }
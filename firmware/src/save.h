@@ -19,7 +19,21 @@ uint64_t board_id_64();
 typedef void (*io_locker_func)(bool pause);
 void save_init(uint32_t magic, mutex_t *lock);
 
+/* Call every frame, it does at most one flash operation per call */
 void save_loop();
+/* Input is going on, a pending save waits until it's quiet for a while */
+void save_hold();
+/* Call at the start of every input frame, flash ops are timed by it */
+void save_frame();
+
+typedef struct {
+    uint32_t saves;
+    uint32_t flash_ops;
+    uint32_t last_stall_us; // longest input frame gap of the last flash job
+    uint32_t max_stall_us;  // since boot
+} save_stat_t;
+
+void save_stat(save_stat_t *stat);
 
 void *save_alloc(size_t size, void *def, void (*after_load)());
 void save_request(bool immediately);
@@ -8,36 +8,112 @@
 #include "slider.h"
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
 #include "hardware/gpio.h"
 #include "hardware/i2c.h"
+#include "hardware/timer.h"
 
 #include "board_defs.h"
 
 #include "config.h"
 #include "mpr121.h"
+#include "latency.h"
+#include "analog.h"
 
 #define MPR121_ADDR 0x5A
 
 static uint16_t readout[36];
-static uint16_t touch[3];
+
+/* I2C IRQ fills scan_buf, slider_update() takes each chip that came
+   back, so one failed read doesn't hold up the other chips */
+static mpr121_frame_t frames[3];
+static mpr121_frame_t scan_buf[3];
+
+static volatile uint32_t touch_scanned_mask = 0;
+static uint32_t touch_scan_mask = 0;
+static uint32_t touch_time[3];
+static bool analog_scan = false;
+
+/* Filtered data and baseline of all three chips take about 2ms of bus
+   time, so they come one chip per frame, touch status every frame */
+static int analog_chip = 0;
+static uint32_t soft_touched = 0;
+static uint32_t touch_bitmap = 0;
+
+#ifdef MPR121_IRQ_GPIO
+static const uint8_t irq_gpio[] = MPR121_IRQ_GPIO;
+static_assert(count_of(irq_gpio) == 3, "Need 3 MPR121 IRQ pins");
+#endif
+
+/* In IRQ mode, still read everything once in a while in case IRQ is lost */
+#define SAFETY_POLL_US 10000
+
 static unsigned touch_count[36];
 static bool present[3];
 
+/* Background health check: every period one chip gets its ECR read back
+   through the scan engine, out-of-range bits come with every touch read.
+   A chip that keeps failing is re-initialized alone, with backoff. */
+#define HEALTH_PERIOD_US 100000
+#define HEALTH_BAD_LIMIT 2       // bad checks in a row before re-init
+#define HEALTH_SETTLE_CHECKS 2   // checks to learn the normal OOR bits
+#define HEALTH_RETRY_MIN_US 1000000
+#define HEALTH_RETRY_MAX_US 32000000
+
+static struct {
+    uint8_t bad;
+    uint8_t settle;
+    uint16_t oor_ref;
+    uint32_t faults;
+    uint32_t reinits;
+    uint32_t retry_us;
+    uint64_t retry_time;
+} health[3];
+
+static struct {
+    volatile enum { CHECK_IDLE, CHECK_PENDING, CHECK_DONE } state;
+    volatile bool ok;
+    int chip;
+    uint8_t ecr;
+    uint64_t next_time;
+} check;
+
+/* A re-initialized chip runs auto-config again, OOR bits may change */
+static void health_reset(int m)
+{
+    health[m].bad = 0;
+    health[m].settle = HEALTH_SETTLE_CHECKS;
+    health[m].oor_ref = 0;
+    health[m].retry_us = HEALTH_RETRY_MIN_US;
+    health[m].retry_time = 0;
+}
+
 void slider_sensor_init()
 {
     for (int m = 0; m < 3; m++) {
         present[m] = mpr121_init(MPR121_ADDR + m);
+        health_reset(m);
     }
     slider_update_config();
 }
 
 void slider_init()
 {
-    i2c_init(I2C_PORT, I2C_FREQ);
+    analog_init();
+
+#ifdef MPR121_IRQ_GPIO
+    for (int m = 0; m < 3; m++) {
+        gpio_init(irq_gpio[m]);
+        gpio_set_dir(irq_gpio[m], GPIO_IN);
+        gpio_pull_up(irq_gpio[m]);
+    }
+#endif
+
+    i2c_scan_bus_init(I2C_FREQ);
     gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);
     gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);
     gpio_pull_up(I2C_SDA);
@@ -48,38 +124,267 @@ void slider_init()
 
 const char *slider_sensor_status()
 {
-    static char status[64];
-    snprintf(status, sizeof(status), "Sensors: %02X:%s %02X:%s %02X:%s",
+    static char status[128];
+    snprintf(status, sizeof(status), "Sensors: %02X:%s %02X:%s %02X:%s, "
+             "faults: %" PRIu32 "/%" PRIu32 "/%" PRIu32
+             ", re-inits: %" PRIu32 "/%" PRIu32 "/%" PRIu32,
              MPR121_ADDR, present[0] ? "OK" : "ERR",
              MPR121_ADDR + 1, present[1] ? "OK" : "ERR",
-             MPR121_ADDR + 2, present[2] ? "OK" : "ERR");
+             MPR121_ADDR + 2, present[2] ? "OK" : "ERR",
+             health[0].faults, health[1].faults, health[2].faults,
+             health[0].reinits, health[1].reinits, health[2].reinits);
     return status;
 }
 
+static void ecr_scanned(const i2c_txn_t *txn, bool ok)
+{
+    check.ok = ok;
+    check.state = CHECK_DONE;
+}
+
+/* Queues one chip's ECR read along with this frame's scan */
+static void health_scan()
+{
+    uint64_t now = time_us_64();
+    if ((check.state != CHECK_IDLE) || (now < check.next_time)) {
+        return;
+    }
+    check.next_time = now + HEALTH_PERIOD_US;
+    check.chip = (check.chip + 1) % 3;
+    check.state = CHECK_PENDING;
+    if (!mpr121_scan_ecr(MPR121_ADDR + check.chip, &check.ecr,
+                         ecr_scanned, check.chip)) {
+        check.state = CHECK_IDLE;
+    }
+}
+
+static void health_judge(int m, bool ecr_ok)
+{
+    uint16_t used = (m != 2) ? 0x0fff : 0x00ff;
+    uint16_t oor = frames[m].oor & used;
+
+    /* some electrodes may be out of range for good, learn them first */
+    if (ecr_ok && (health[m].settle > 0)) {
+        health[m].settle--;
+        health[m].oor_ref |= oor;
+        return;
+    }
+
+    if (ecr_ok && !(oor & ~health[m].oor_ref)) {
+        health[m].bad = 0;
+        health[m].retry_us = HEALTH_RETRY_MIN_US;
+        present[m] = true;
+        return;
+    }
+
+    if (health[m].bad < HEALTH_BAD_LIMIT) {
+        health[m].bad++;
+    }
+    if ((health[m].bad >= HEALTH_BAD_LIMIT) && present[m]) {
+        present[m] = false;
+        health[m].faults++;
+    }
+}
+
+/* At most one chip per frame, the others keep scanning meanwhile */
+static void health_recover()
+{
+    uint64_t now = time_us_64();
+    for (int m = 0; m < 3; m++) {
+        if (present[m] || (health[m].bad < HEALTH_BAD_LIMIT) ||
+            (now < health[m].retry_time)) {
+            continue;
+        }
+
+        health[m].reinits++;
+        uint32_t retry_us = health[m].retry_us;
+        present[m] = mpr121_init(MPR121_ADDR + m);
+        health_reset(m);
+        slider_update_config(); // only this chip has anything to write
+
+        health[m].retry_time = time_us_64() + retry_us;
+        health[m].retry_us = retry_us * 2 < HEALTH_RETRY_MAX_US ?
+                             retry_us * 2 : HEALTH_RETRY_MAX_US;
+        return;
+    }
+}
+
+/* Bus is idle here, a check still pending was dropped by the scan engine */
+static void health_update()
+{
+    if (check.state == CHECK_PENDING) {
+        check.state = CHECK_IDLE;
+    } else if (check.state == CHECK_DONE) {
+        check.state = CHECK_IDLE;
+        health_judge(check.chip, check.ok && (check.ecr == MPR121_RUN_ECR));
+    }
+    health_recover();
+}
+
+static void touch_scanned(const i2c_txn_t *txn, bool ok)
+{
+    int m = txn->arg;
+    if (!ok) {
+        scan_buf[m].touched = 0;
+    }
+    touch_time[m] = time_us_32();
+    touch_scanned_mask |= 1 << m;
+}
+
+static inline bool soft_touch()
+{
+    return chu_cfg->tweak.touch_mode != 0;
+}
+
+/* MPR121 holds its IRQ low until touch status is read */
+static uint32_t touch_changed_mask()
+{
+#ifdef MPR121_IRQ_GPIO
+    static uint64_t last_poll = 0;
+    uint64_t now = time_us_64();
+
+    if (chu_cfg->tweak.touch_irq && !analog_scan && !soft_touch() &&
+        (now - last_poll < SAFETY_POLL_US)) {
+        uint32_t mask = 0;
+        for (int m = 0; m < 3; m++) {
+            if (!gpio_get(irq_gpio[m])) {
+                mask |= 1 << m;
+            }
+        }
+        return mask;
+    }
+    last_poll = now;
+#endif
+    return 0x07;
+}
+
+void slider_scan()
+{
+    health_scan();
+
+    touch_scan_mask = touch_changed_mask();
+    touch_scanned_mask = 0;
+    if (!touch_scan_mask) {
+        return;
+    }
+
+    bool analog = analog_scan || soft_touch();
+    if (analog) {
+        analog_chip = (analog_chip + 1) % 3;
+    }
+
+    memcpy(scan_buf, frames, sizeof(scan_buf));
+    for (int m = 0; m < 3; m++) {
+        if (touch_scan_mask & (1 << m)) {
+            mpr121_scan_frame(MPR121_ADDR + m, &scan_buf[m],
+                              analog && (m == analog_chip), touch_scanned, m);
+        }
+    }
+}
+
+/* only the chip whose analog data was just read */
+static void soft_process(int m)
+{
+    uint16_t filtered[ANALOG_PAD_NUM];
+    uint8_t baseline[ANALOG_PAD_NUM];
+    for (int i = 0; i < ANALOG_PAD_NUM; i++) {
+        filtered[i] = frames[i / 12].filtered[i % 12];
+        baseline[i] = frames[i / 12].baseline[i % 12];
+    }
+    soft_touched = analog_process_part(filtered, baseline, m * 12, 12);
+}
+
+static inline uint16_t chip_touched(int m)
+{
+    if (soft_touch()) {
+        return (soft_touched >> (m * 12)) & 0x0fff;
+    }
+    return frames[m].touched;
+}
+
 void slider_update()
 {
     static uint16_t last_touched[3];
 
-    touch[0] = mpr121_touched(MPR121_ADDR);
-    touch[1] = mpr121_touched(MPR121_ADDR + 1);
-    touch[2] = mpr121_touched(MPR121_ADDR + 2);
+    /* bus is idle here, what didn't come back keeps its last reading */
+    uint32_t scanned = touch_scanned_mask & touch_scan_mask;
+    for (int m = 0; m < 3; m++) {
+        if (scanned & (1 << m)) {
+            frames[m] = scan_buf[m];
+        }
+    }
+    if (soft_touch() && (scanned & (1 << analog_chip))) {
+        soft_process(analog_chip);
+    }
+    touch_scan_mask = 0;
+
+    if (soft_touch()) {
+        touch_bitmap = soft_touched;
+    } else {
+        touch_bitmap = (frames[0].touched & 0x0fff) |
+                       ((frames[1].touched & 0x0fff) << 12) |
+                       ((uint32_t)frames[2].touched << 24);
+    }
 
     for (int m = 0; m < 3; m++) {
-        uint16_t just_touched = touch[m] & ~last_touched[m];
-        last_touched[m] = touch[m];
+        uint16_t touched = chip_touched(m);
+        uint16_t just_touched = touched & ~last_touched[m];
+        last_touched[m] = touched;
+        if (just_touched) {
+            latency_begin(touch_time[m], time_us_32());
+        }
         for (int i = 0; i < 12; i++) {
             if (just_touched & (1 << i)) {
                 touch_count[m * 12 + i]++;
             }
         }
     }
+
+    health_update();
+}
+
+/* Contact positions along the slider, only in software touch mode */
+int slider_contacts(uint8_t pos[ANALOG_MAX_CONTACTS])
+{
+    if (!soft_touch()) {
+        memset(pos, 0, ANALOG_MAX_CONTACTS);
+        return 0;
+    }
+    return analog_contacts(pos);
+}
+
+/* Scan filtered data and baseline along with touch status, one chip
+   per frame in turn */
+void slider_analog_scan(bool enable)
+{
+    analog_scan = enable;
+}
+
+const mpr121_frame_t *slider_frame(unsigned chip)
+{
+    if (chip >= 3) {
+        return NULL;
+    }
+    return &frames[chip];
 }
 
 const uint16_t *slider_raw()
 {
-    mpr121_raw(MPR121_ADDR, readout, 12);
-    mpr121_raw(MPR121_ADDR + 1, readout + 12, 12);
-    mpr121_raw(MPR121_ADDR + 2, readout + 24, 12);
+    mpr121_frame_t cache[3];
+    const mpr121_frame_t *src = frames;
+
+    if (!analog_scan) {
+        for (int m = 0; m < 3; m++) {
+            mpr121_read_frame(MPR121_ADDR + m, &cache[m], true);
+        }
+        src = cache;
+    }
+
+    for (int m = 0; m < 3; m++) {
+        for (int i = 0; i < 12; i++) {
+            readout[m * 12 + i] = src[m].filtered[i] & 0x3ff;
+        }
+    }
     return readout;
 }
 
@@ -88,7 +393,12 @@ bool slider_touched(unsigned key)
     if (key >= 32) {
         return 0;
     }
-    return touch[key / 12] & (1 << (key % 12));
+    return touch_bitmap & (1 << key);
+}
+
+uint32_t slider_bitmap()
+{
+    return touch_bitmap;
 }
 
 unsigned slider_count(unsigned key)
@@ -104,6 +414,7 @@ void slider_reset_stat()
     memset(touch_count, 0, sizeof(touch_count));
 }
 
+/* MPR121 driver shadows the registers, only what differs is written */
 void slider_update_config()
 {
     for (int m = 0; m < 3; m++) {
@@ -115,5 +426,12 @@ void slider_update_config()
         mpr121_filter(MPR121_ADDR + m, chu_cfg->sense.filter >> 6,
                                        (chu_cfg->sense.filter >> 4) & 0x03,
                                        chu_cfg->sense.filter & 0x07);
+        mpr121_apply(MPR121_ADDR + m);
+    }
+
+    for (int i = 0; i < ANALOG_PAD_NUM; i++) {
+        int8_t sense = chu_cfg->sense.global + chu_cfg->sense.keys[i];
+        analog_threshold(i, mpr121_touch_threshold(sense),
+                            mpr121_release_threshold(sense));
     }
 }
@@ -9,11 +9,20 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "mpr121.h"
+#include "analog.h"
+
 void slider_init();
 void slider_sensor_init();
+void slider_scan();
 void slider_update();
 bool slider_touched(unsigned key);
+/* bit n is key n, refreshed once per slider_update() */
+uint32_t slider_bitmap();
+int slider_contacts(uint8_t pos[ANALOG_MAX_CONTACTS]);
 const uint16_t *slider_raw();
+void slider_analog_scan(bool enable);
+const mpr121_frame_t *slider_frame(unsigned chip);
 void slider_update_config();
 unsigned slider_count(unsigned key);
 void slider_reset_stat();
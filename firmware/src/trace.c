@@ -0,0 +1,106 @@
+/*
+ * Raw Sensor Trace Recorder
+ * WHowe <github.com/whowechina>
+ *
+ * Streams timestamped sensor frames over the CLI CDC interface
+ */
+
+#include "trace.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "hardware/timer.h"
+#include "tusb.h"
+
+#include "config.h"
+#include "slider.h"
+#include "air.h"
+
+static const int cli_intf = 0;
+
+static bool running = false;
+static uint32_t sent = 0;
+static uint32_t dropped = 0;
+
+void trace_start()
+{
+    sent = 0;
+    dropped = 0;
+    slider_analog_scan(true);
+    running = true;
+}
+
+void trace_stop()
+{
+    running = false;
+    slider_analog_scan(false);
+}
+
+bool trace_running()
+{
+    return running;
+}
+
+uint32_t trace_sent()
+{
+    return sent;
+}
+
+uint32_t trace_dropped()
+{
+    return dropped;
+}
+
+static void fill_frame(trace_frame_t *frame)
+{
+    frame->sync[0] = TRACE_SYNC0;
+    frame->sync[1] = TRACE_SYNC1;
+    frame->len = sizeof(*frame);
+    frame->flags = TRACE_FLAG_FILTERED;
+    frame->time_us = time_us_32();
+
+    for (int m = 0; m < 3; m++) {
+        const mpr121_frame_t *chip = slider_frame(m);
+        frame->touched[m] = chip->touched;
+        for (int i = 0; (i < 12) && (m * 12 + i < TRACE_PAD_NUM); i++) {
+            frame->filtered[m * 12 + i] = chip->filtered[i] & 0x3ff;
+        }
+    }
+
+    if (chu_cfg->ir.enabled) {
+        frame->flags |= TRACE_FLAG_IR;
+    }
+    for (int i = 0; i < TRACE_TOF_NUM; i++) {
+        frame->tof[i] = air_tof_raw(i);
+    }
+    for (int i = 0; i < TRACE_IR_NUM; i++) {
+        frame->ir[i] = air_ir_raw(i);
+    }
+
+    uint8_t sum = 0;
+    const uint8_t *data = (const uint8_t *)frame;
+    for (int i = 0; i < sizeof(*frame) - 1; i++) {
+        sum += data[i];
+    }
+    frame->checksum = sum;
+}
+
+void trace_frame()
+{
+    if (!running) {
+        return;
+    }
+
+    if (tud_cdc_n_write_available(cli_intf) < sizeof(trace_frame_t)) {
+        dropped++;
+        return;
+    }
+
+    trace_frame_t frame;
+    fill_frame(&frame);
+    tud_cdc_n_write(cli_intf, &frame, sizeof(frame));
+    tud_cdc_n_write_flush(cli_intf);
+    sent++;
+}
@@ -0,0 +1,45 @@
+/*
+ * Raw Sensor Trace Recorder
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_SYNC0 0xa5
+#define TRACE_SYNC1 0x5a
+
+#define TRACE_FLAG_IR 0x01       // air is IR, tof[] is not valid
+#define TRACE_FLAG_FILTERED 0x02 // filtered[] is valid
+
+#define TRACE_PAD_NUM 32
+#define TRACE_TOF_NUM 5
+#define TRACE_IR_NUM 6
+
+/* One frame per core 0 loop, little endian, streamed as is on the CLI
+   CDC. Host side syncs on sync bytes and checks len and checksum, since
+   CLI echo may get mixed in. */
+typedef struct __attribute__((packed)) {
+    uint8_t sync[2];
+    uint8_t len;
+    uint8_t flags;
+    uint32_t time_us;
+    uint16_t touched[3];
+    uint16_t filtered[TRACE_PAD_NUM];
+    uint16_t tof[TRACE_TOF_NUM];
+    uint16_t ir[TRACE_IR_NUM];
+    uint8_t checksum; // sum of all bytes before it
+} trace_frame_t;
+
+void trace_start();
+void trace_stop();
+bool trace_running();
+void trace_frame();
+
+uint32_t trace_sent();
+uint32_t trace_dropped();
+
+#endif
@@ -74,6 +74,7 @@ uint8_t const desc_hid_report_led[] = {
     CHUPICO_REPORT_DESC_LED_SLIDER_15,
     CHUPICO_REPORT_DESC_LED_TOWER_6,
     CHUPICO_REPORT_DESC_LED_COMPRESSED,
+    CHUPICO_REPORT_DESC_LED_DELTA,
     CHUPICO_LED_FOOTER
 };
 
@@ -10,6 +10,7 @@ enum {
     REPORT_ID_LED_SLIDER_15 = 5,
     REPORT_ID_LED_TOWER_6 = 6,
     REPORT_ID_LED_COMPRESSED = 11,
+    REPORT_ID_LED_DELTA = 12,
 };
 
 // because they are missing from tusb_hid.h
@@ -102,6 +103,16 @@ enum {
         HID_REPORT_SIZE(8), HID_REPORT_COUNT(63),                              \
         HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE)
 
+// LEDs Delta, only changed ranges: [first LED, LED count, count*3 BRG]...
+// a zero count (or the end of the report) finishes it
+#define CHUPICO_REPORT_DESC_LED_DELTA                                          \
+        HID_REPORT_ID(REPORT_ID_LED_DELTA)                                     \
+        HID_USAGE_PAGE(HID_USAGE_PAGE_ORDINAL),                                \
+        HID_USAGE(0x00),                                                       \
+        HID_LOGICAL_MIN(0x00), HID_LOGICAL_MAX_N(0x00ff, 2),                   \
+        HID_REPORT_SIZE(8), HID_REPORT_COUNT(63),                              \
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE)
+
 #define CHUPICO_REPORT_DESC_NKRO                                               \
     HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                    \
     HID_USAGE(HID_USAGE_DESKTOP_KEYBOARD),                                     \
@@ -639,6 +639,59 @@ uint16_t readRangeContinuousMillimeters(int index)
     return instances[index].range;
 }
 
+static struct {
+    uint8_t status;
+    uint8_t range[2];
+    vl53l0x_scan_cb done;
+} scans[INSTANCE_NUM];
+
+static void scan_finish(int index, bool ok)
+{
+    scans[index].done(index, instances[index].range, ok);
+}
+
+static void scan_cleared(const i2c_txn_t *txn, bool ok)
+{
+    scan_finish(txn->arg, ok);
+}
+
+static void scan_ranged(const i2c_txn_t *txn, bool ok)
+{
+    int index = txn->arg;
+    if (ok) {
+        instances[index].range = (scans[index].range[0] << 8) | scans[index].range[1];
+    }
+
+    const uint8_t clear[] = { SYSTEM_INTERRUPT_CLEAR, 0x01 };
+    if (!i2c_scan_write(addr, clear, 2, scan_cleared, index)) {
+        scan_finish(index, false);
+    }
+}
+
+static void scan_status(const i2c_txn_t *txn, bool ok)
+{
+    int index = txn->arg;
+    if (!ok || ((scans[index].status & 0x07) == 0)) {
+        scan_finish(index, ok); // use last result
+        return;
+    }
+
+    if (!i2c_scan_read(addr, RESULT_RANGE_STATUS + 10, scans[index].range, 2,
+                       scan_ranged, index)) {
+        scan_finish(index, false);
+    }
+}
+
+bool vl53l0x_scan_range(int index, vl53l0x_scan_cb done)
+{
+    if (index >= INSTANCE_NUM) {
+        return false;
+    }
+    scans[index].done = done;
+    return i2c_scan_read(addr, RESULT_INTERRUPT_STATUS, &scans[index].status, 1,
+                         scan_status, index);
+}
+
 #if 0
 // Performs a single-shot range measurement and returns the reading in
 // millimeters
@@ -12,6 +12,7 @@
 #include <stdbool.h>
 
 #include "hardware/i2c.h"
+#include "i2c_scan.h"
 
 // register addresses from API vl53l0x_device.h (ordered as listed there)
 enum regAddr
@@ -122,6 +123,11 @@ void vl53l0x_stop_continuous(int index);
 uint16_t readRangeContinuousMillimeters(int index);
 uint16_t readRangeSingleMillimeters(int index);
 
+/* Queued version of readRangeContinuousMillimeters(), done is called
+   from the I2C IRQ with the latest range */
+typedef void (*vl53l0x_scan_cb)(int index, uint16_t range, bool ok);
+bool vl53l0x_scan_range(int index, vl53l0x_scan_cb done);
+
 // TCC: Target CentreCheck
 // MSRC: Minimum Signal Rate Check
 // DSS: Dynamic Spad Selection
@@ -0,0 +1,151 @@
+/*
+ * Host Micro Benchmarks
+ * WHowe <github.com/whowechina>
+ *
+ * Per call cost of the firmware hot paths, median of many batches.
+ * Budgets are loose on purpose, they catch a regression of a different
+ * order, not a few percent. Run with "-n" to report without failing.
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define BATCH_CALLS 1000
+#define BATCH_NUM 31
+#define WARMUP_CALLS 1000
+
+extern const bench_t report_benches[];
+extern const bench_t lzfx_benches[];
+extern const bench_t latency_benches[];
+extern const bench_t analog_benches[];
+extern const bench_t lights_benches[];
+extern const bench_t rgb_benches[];
+
+static const bench_t *suites[] = {
+    report_benches,
+    lzfx_benches,
+    latency_benches,
+    analog_benches,
+    lights_benches,
+    rgb_benches,
+};
+
+volatile uint32_t bench_sink;
+
+uint64_t bench_clock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+const char *bench_unit()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+static uint32_t rand_state = 1;
+
+void bench_seed(uint32_t seed)
+{
+    rand_state = seed ? seed : 1;
+}
+
+/* xorshift32 */
+uint32_t bench_rand()
+{
+    uint32_t x = rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rand_state = x;
+    return x;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* true if within budget */
+static bool measure(const bench_t *bench, bool enforce)
+{
+    if (bench->setup) {
+        bench->setup();
+    }
+    for (int i = 0; i < WARMUP_CALLS; i++) {
+        bench->run();
+    }
+
+    double per_call[BATCH_NUM];
+    for (int b = 0; b < BATCH_NUM; b++) {
+        uint64_t start = bench_clock();
+        for (int i = 0; i < BATCH_CALLS; i++) {
+            bench->run();
+        }
+        per_call[b] = (double)(bench_clock() - start) / BATCH_CALLS;
+    }
+    qsort(per_call, BATCH_NUM, sizeof(per_call[0]), cmp_double);
+
+    double median = per_call[BATCH_NUM / 2];
+    bool ok = (bench->budget == 0) || (median <= bench->budget);
+    printf("%-32s %10.1f %10.1f %10u  %-4s", bench->name, median, per_call[0],
+           bench->budget, ok ? "ok" : (enforce ? "OVER" : "over"));
+    if (bench->bytes) {
+        printf(" %6u", bench->bytes);
+    }
+    printf("\n");
+    return ok || !enforce;
+}
+
+int main(int argc, char *argv[])
+{
+    bool enforce = true;
+    const char *filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0) {
+            enforce = false;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    printf("%-32s %10s %10s %10s  %-4s %6s  (%s per call)\n", "benchmark",
+           "median", "min", "budget", "", "bytes", bench_unit());
+
+    int failed = 0;
+    for (int s = 0; s < sizeof(suites) / sizeof(suites[0]); s++) {
+        for (const bench_t *bench = suites[s]; bench->name; bench++) {
+            if (filter && !strstr(bench->name, filter)) {
+                continue;
+            }
+            if (!measure(bench, enforce)) {
+                failed++;
+            }
+        }
+    }
+
+    if (failed) {
+        printf("%d over budget\n", failed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * Host Micro Benchmarks
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    const char *name;
+    void (*setup)();  // optional, before warm up
+    void (*run)();    // exactly one call of what's measured
+    uint32_t budget;  // per call, fails above it, 0 only reports
+    uint32_t bytes;   // memory read and written per call, if counted
+} bench_t;
+
+/* suites end with an entry without name */
+#define BENCH_END { 0 }
+
+/* TSC cycles on x86, nanoseconds elsewhere */
+uint64_t bench_clock();
+const char *bench_unit();
+
+/* results go here so nothing gets optimized away */
+extern volatile uint32_t bench_sink;
+
+/* deterministic, same numbers on every run */
+uint32_t bench_rand();
+void bench_seed(uint32_t seed);
+
+#endif
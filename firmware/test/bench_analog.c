@@ -0,0 +1,58 @@
+/*
+ * Analog touch engine benchmarks
+ * WHowe <github.com/whowechina>
+ */
+
+#include "bench.h"
+
+#include "analog.h"
+
+#define FRAME_NUM 64
+
+static uint16_t filtered[FRAME_NUM][ANALOG_PAD_NUM];
+static uint8_t baseline[ANALOG_PAD_NUM];
+static unsigned pos;
+
+static void setup()
+{
+    analog_init();
+    bench_seed(6);
+    for (int i = 0; i < ANALOG_PAD_NUM; i++) {
+        baseline[i] = 150 + bench_rand() % 40;
+    }
+    /* a couple of fingers wandering over noisy pads */
+    for (int f = 0; f < FRAME_NUM; f++) {
+        int finger[2] = { (f * 3) % ANALOG_PAD_NUM, (31 - f) % ANALOG_PAD_NUM };
+        for (int i = 0; i < ANALOG_PAD_NUM; i++) {
+            int v = (baseline[i] << 2) + (int)(bench_rand() % 7) - 3;
+            for (int k = 0; k < 2; k++) {
+                int d = i - finger[k];
+                if ((d >= -1) && (d <= 1)) {
+                    v -= (d == 0) ? 60 : 25;
+                }
+            }
+            filtered[f][i] = v;
+        }
+    }
+    pos = 0;
+}
+
+static void run_process()
+{
+    bench_sink += analog_process(filtered[pos], baseline);
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+static void run_contacts()
+{
+    uint8_t contacts[ANALOG_MAX_CONTACTS];
+    analog_process(filtered[pos], baseline);
+    bench_sink += analog_contacts(contacts) + contacts[0];
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+const bench_t analog_benches[] = {
+    { "analog_process", setup, run_process, 1000 },
+    { "analog_process+contacts", setup, run_contacts, 1000 },
+    BENCH_END
+};
@@ -0,0 +1,38 @@
+/*
+ * Latency statistics benchmarks
+ * WHowe <github.com/whowechina>
+ */
+
+#include "bench.h"
+
+#include "latency.h"
+
+static uint32_t now;
+
+static void setup()
+{
+    latency_reset();
+    now = 0;
+}
+
+/* one traced touch: sampled, updated, built and sent */
+static void run_trace()
+{
+    latency_begin(now, now + 120);
+    latency_mark(LATENCY_BUILT, now + 150);
+    latency_end(now + 400 + (now & 0x3ff));
+    now += 1000;
+}
+
+static void run_untraced()
+{
+    latency_mark(LATENCY_BUILT, now);
+    latency_end(now);
+    now += 1000;
+}
+
+const bench_t latency_benches[] = {
+    { "latency(traced touch)", setup, run_trace, 100 },
+    { "latency(idle frame)", setup, run_untraced, 60 },
+    BENCH_END
+};
@@ -0,0 +1,101 @@
+/*
+ * Lighting effect benchmarks
+ * WHowe <github.com/whowechina>
+ */
+
+#include "bench.h"
+
+#include "config.h"
+#include "lights.h"
+#include "host_boot.h"
+
+#define INPUT_NUM 256
+
+static lights_input_t inputs[INPUT_NUM];
+static unsigned pos;
+static uint32_t now_us;
+
+static void setup_inputs()
+{
+    host_boot();
+    bench_seed(18);
+    for (int i = 0; i < INPUT_NUM; i++) {
+        inputs[i].touched = (bench_rand() & bench_rand() & bench_rand());
+        inputs[i].tof_num = 5;
+        for (int t = 0; t < 5; t++) {
+            inputs[i].tof[t] = bench_rand() % 8;
+        }
+    }
+    pos = 0;
+    now_us = 0;
+}
+
+static void setup_classic()
+{
+    setup_inputs();
+    chu_cfg->style.key = 0;
+    chu_cfg->style.gap = 0;
+    chu_cfg->style.tof = 0;
+}
+
+static void setup_fade()
+{
+    setup_inputs();
+    chu_cfg->style.key = 1;
+    chu_cfg->style.gap = 1;
+    chu_cfg->style.tof = 1;
+}
+
+static void setup_ripple()
+{
+    setup_inputs();
+    chu_cfg->style.key = 2;
+    chu_cfg->style.gap = 1;
+    chu_cfg->style.tof = 1;
+}
+
+/*
+ * Worst case for the budget: every pair toggles each frame so ripples
+ * restart all the time, six ToF indicators, breathing gaps and ToF.
+ */
+static void setup_worst()
+{
+    setup_inputs();
+    for (int i = 0; i < INPUT_NUM; i++) {
+        inputs[i].touched = (i & 1) ? 0xffffffff : 0;
+        inputs[i].tof_num = 6;
+        for (int t = 0; t < 6; t++) {
+            inputs[i].tof[t] = (i + t) % 7;
+        }
+    }
+    chu_cfg->style.gap = 1;
+    chu_cfg->style.tof = 1;
+}
+
+static void setup_worst_fade()
+{
+    setup_worst();
+    chu_cfg->style.key = 1;
+}
+
+static void setup_worst_ripple()
+{
+    setup_worst();
+    chu_cfg->style.key = 2;
+}
+
+static void run_update()
+{
+    lights_update(now_us, &inputs[pos]);
+    pos = (pos + 1) % INPUT_NUM;
+    now_us += 1000;
+}
+
+const bench_t lights_benches[] = {
+    { "lights_update(classic)", setup_classic, run_update, 2000 },
+    { "lights_update(fade)", setup_fade, run_update, 2000 },
+    { "lights_update(ripple)", setup_ripple, run_update, 3000 },
+    { "lights_update(fade,worst)", setup_worst_fade, run_update, 2000 },
+    { "lights_update(ripple,worst)", setup_worst_ripple, run_update, 3000 },
+    BENCH_END
+};
@@ -0,0 +1,86 @@
+/*
+ * LED frame decompression benchmarks
+ * WHowe <github.com/whowechina>
+ */
+
+#include "bench.h"
+
+#include "lzfx.h"
+#include "lzfx_enc.h"
+#include "led_stream.h"
+#include "ref/lzfx_ref.h"
+
+#define FRAME_NUM 64
+
+static uint8_t packed[FRAME_NUM][LED_STREAM_BYTES * 2];
+static unsigned packed_len[FRAME_NUM];
+static unsigned pos;
+
+static void setup()
+{
+    led_stream_init(16);
+    for (int i = 0; i < FRAME_NUM; i++) {
+        uint8_t brg[LED_STREAM_BYTES];
+        led_stream_next(brg);
+        packed_len[i] = sizeof(packed[i]);
+        lzfx_compress(brg, sizeof(brg), packed[i], &packed_len[i]);
+    }
+    pos = 0;
+}
+
+static void run_frame()
+{
+    uint8_t out[(48 + 45 + 6) * 3]; // same as the firmware's buffer
+    unsigned olen = sizeof(out);
+    lzfx_decompress(packed[pos], packed_len[pos], out, &olen);
+    bench_sink += olen + out[olen - 1];
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+static void run_frame_ref()
+{
+    uint8_t out[(48 + 45 + 6) * 3];
+    unsigned olen = sizeof(out);
+    lzfx_decompress_ref(packed[pos], packed_len[pos], out, &olen);
+    bench_sink += olen + out[olen - 1];
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+/* throughput on a long mostly repeating stream, 4KB out per call */
+static uint8_t long_packed[4096];
+static unsigned long_len;
+
+static void setup_long()
+{
+    static uint8_t data[4096];
+    led_stream_init(160);
+    for (int i = 0; i + LED_STREAM_BYTES <= sizeof(data); i += LED_STREAM_BYTES) {
+        led_stream_next(data + i);
+    }
+    long_len = sizeof(long_packed);
+    lzfx_compress(data, sizeof(data), long_packed, &long_len);
+}
+
+static void run_long()
+{
+    static uint8_t out[4096];
+    unsigned olen = sizeof(out);
+    lzfx_decompress(long_packed, long_len, out, &olen);
+    bench_sink += olen;
+}
+
+static void run_long_ref()
+{
+    static uint8_t out[4096];
+    unsigned olen = sizeof(out);
+    lzfx_decompress_ref(long_packed, long_len, out, &olen);
+    bench_sink += olen;
+}
+
+const bench_t lzfx_benches[] = {
+    { "lzfx_decompress(led frame)", setup, run_frame, 800 },
+    { "lzfx_decompress_ref(led frame)", setup, run_frame_ref, 0 },
+    { "lzfx_decompress(4KB)", setup_long, run_long, 15000 },
+    { "lzfx_decompress_ref(4KB)", setup_long, run_long_ref, 0 },
+    BENCH_END
+};
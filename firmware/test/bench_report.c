@@ -0,0 +1,86 @@
+/*
+ * HID report packing benchmarks
+ * WHowe <github.com/whowechina>
+ *
+ * Per frame cost, so the new ones include stitching the touch words the
+ * way slider_update() does, the old ones set up slider_touched() instead.
+ */
+
+#include "bench.h"
+
+#include "config.h"
+#include "report.h"
+#include "host_boot.h"
+#include "ref/report_ref.h"
+
+#define INPUT_NUM 256
+
+static struct {
+    uint16_t touch[3];
+    uint8_t air;
+    uint16_t aux;
+} inputs[INPUT_NUM];
+static unsigned pos;
+
+static void setup()
+{
+    host_boot();
+    bench_seed(10);
+    for (int i = 0; i < INPUT_NUM; i++) {
+        for (int m = 0; m < 3; m++) { // a few keys at a time
+            inputs[i].touch[m] = bench_rand() & bench_rand() & (m < 2 ? 0x0fff : 0x00ff);
+        }
+        inputs[i].air = bench_rand() & 0x3f;
+        inputs[i].aux = bench_rand() & 0x07;
+    }
+    report_nkro_keymap(chu_cfg->nkro.keymap);
+    pos = 0;
+}
+
+static inline uint32_t stitch(const uint16_t *touch)
+{
+    return (touch[0] & 0x0fff) | ((touch[1] & 0x0fff) << 12) |
+           ((uint32_t)touch[2] << 24);
+}
+
+static void run_joy()
+{
+    hid_joy_t joy;
+    report_gen_joy(&joy, stitch(inputs[pos].touch), inputs[pos].air, inputs[pos].aux);
+    bench_sink += joy.axis + joy.buttons;
+    pos = (pos + 1) % INPUT_NUM;
+}
+
+static void run_joy_ref()
+{
+    hid_joy_t joy;
+    slider_ref_set(inputs[pos].touch);
+    gen_joy_report_ref(&joy, inputs[pos].air, inputs[pos].aux);
+    bench_sink += joy.axis + joy.buttons;
+    pos = (pos + 1) % INPUT_NUM;
+}
+
+static void run_nkro()
+{
+    hid_nkro_t nkro;
+    report_gen_nkro(&nkro, stitch(inputs[pos].touch), inputs[pos].air, inputs[pos].aux);
+    bench_sink += nkro.keymap[0] + nkro.keymap[5];
+    pos = (pos + 1) % INPUT_NUM;
+}
+
+static void run_nkro_ref()
+{
+    static hid_nkro_t nkro;
+    slider_ref_set(inputs[pos].touch);
+    gen_nkro_report_ref(&nkro, inputs[pos].air, inputs[pos].aux);
+    bench_sink += nkro.keymap[0] + nkro.keymap[5];
+    pos = (pos + 1) % INPUT_NUM;
+}
+
+const bench_t report_benches[] = {
+    { "report_gen_joy", setup, run_joy, 50 },
+    { "gen_joy_report_ref", setup, run_joy_ref, 0 },
+    { "report_gen_nkro", setup, run_nkro, 400 },
+    { "gen_nkro_report_ref", setup, run_nkro_ref, 0 },
+    BENCH_END
+};
@@ -0,0 +1,135 @@
+/*
+ * Host LED frame benchmarks
+ * WHowe <github.com/whowechina>
+ */
+
+#include "bench.h"
+
+#include "rgb.h"
+#include "lzfx_enc.h"
+#include "led_stream.h"
+#include "led_delta.h"
+#include "host.h"
+#include "host_boot.h"
+#include "ref/led_ref.h"
+
+#define FRAME_NUM 64
+#define LED_FRAME_US 4000 // LED_HOST_FRAME_US in rgb.c
+
+/* LED data loaded and stored per host frame: BRG in, level LUT and host
+   frame out (10 per LED), then straight into the DMA frames (8 per word).
+   The old path also snapshots the host frame and merges it into buf_main
+   on core 1 (8 per buf_main word and 12 per LED). The lzfx paths add
+   their decoded output, decoder reads are not counted. */
+#define PATH_BYTES (10 * LED_STREAM_LEDS + \
+                    8 * (LED_REF_FRAME_MAIN + LED_REF_FRAME_TOWER))
+#define REF_PATH_BYTES (PATH_BYTES + 12 * LED_STREAM_LEDS + 8 * LED_REF_NUM)
+#define LZFX_PATH_BYTES (PATH_BYTES + 3 * LED_STREAM_LEDS)
+#define REF_LZFX_PATH_BYTES (REF_PATH_BYTES + 3 * LED_STREAM_LEDS)
+
+static uint8_t frames[FRAME_NUM][LED_STREAM_BYTES];
+static uint8_t packed[FRAME_NUM][LED_STREAM_BYTES * 2];
+static unsigned packed_len[FRAME_NUM];
+static uint8_t delta[FRAME_NUM][2][LED_DELTA_REPORT_LEN];
+static int delta_num[FRAME_NUM];
+static unsigned pos;
+
+static void setup()
+{
+    host_boot();
+    led_stream_init(8);
+    for (int i = 0; i < FRAME_NUM; i++) {
+        led_stream_next(frames[i]);
+        packed_len[i] = sizeof(packed[i]);
+        lzfx_compress(frames[i], LED_STREAM_BYTES, packed[i], &packed_len[i]);
+    }
+    /* deltas go around the loop, the last frame to the first */
+    for (int i = 0; i < FRAME_NUM; i++) {
+        const uint8_t *prev = frames[(i + FRAME_NUM - 1) % FRAME_NUM];
+        delta_num[i] = led_delta_encode(prev, frames[i], LED_STREAM_LEDS, delta[i], 2);
+    }
+    led_ref_init();
+    pos = 0;
+}
+
+/* the three uncompressed reports of one frame */
+static void run_brg()
+{
+    rgb_set_brg(0, frames[pos], 16);
+    rgb_set_brg(16, frames[pos] + 16 * 3, 15);
+    rgb_set_brg(31, frames[pos] + 31 * 3, 6);
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+static void run_lzfx()
+{
+    bench_sink += rgb_set_brg_lzfx(packed[pos], packed_len[pos]);
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+static void run_delta()
+{
+    for (int i = 0; i < delta_num[pos]; i++) {
+        bench_sink += rgb_set_brg_delta(delta[pos][i], LED_DELTA_REPORT_LEN);
+    }
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+/* core 1 side, taking the frame */
+static void run_pull()
+{
+    rgb_set_brg(0, frames[pos], LED_STREAM_LEDS);
+    rgb_pull_host();
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+/* One host frame all the way to the DMA frames, now and before */
+static void run_path()
+{
+    run_brg();
+    rgb_pull_host();
+    host_time_advance(LED_FRAME_US);
+    rgb_update();
+}
+
+static void run_path_ref()
+{
+    static uint32_t frame_main[LED_REF_FRAME_MAIN];
+    static uint32_t frame_tower[LED_REF_FRAME_TOWER];
+    led_ref_set_brg(0, frames[pos], 16);
+    led_ref_set_brg(16, frames[pos] + 16 * 3, 15);
+    led_ref_set_brg(31, frames[pos] + 31 * 3, 6);
+    led_ref_pull();
+    bench_sink += led_ref_fill(frame_main, frame_tower);
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+static void run_lzfx_path()
+{
+    run_lzfx();
+    rgb_pull_host();
+    host_time_advance(LED_FRAME_US);
+    rgb_update();
+}
+
+static void run_lzfx_path_ref()
+{
+    static uint32_t frame_main[LED_REF_FRAME_MAIN];
+    static uint32_t frame_tower[LED_REF_FRAME_TOWER];
+    bench_sink += led_ref_set_brg_lzfx(packed[pos], packed_len[pos]);
+    led_ref_pull();
+    bench_sink += led_ref_fill(frame_main, frame_tower);
+    pos = (pos + 1) % FRAME_NUM;
+}
+
+const bench_t rgb_benches[] = {
+    { "rgb_set_brg(3 reports)", setup, run_brg, 1500 },
+    { "rgb_set_brg_lzfx", setup, run_lzfx, 1500 },
+    { "rgb_set_brg_delta", setup, run_delta, 1500 },
+    { "rgb_set_brg+rgb_pull_host", setup, run_pull, 1200 },
+    { "led path(3 reports)", setup, run_path, 2500, PATH_BYTES },
+    { "led path_ref(3 reports)", setup, run_path_ref, 0, REF_PATH_BYTES },
+    { "led path(lzfx)", setup, run_lzfx_path, 2500, LZFX_PATH_BYTES },
+    { "led path_ref(lzfx)", setup, run_lzfx_path_ref, 0, REF_LZFX_PATH_BYTES },
+    BENCH_END
+};
@@ -0,0 +1,299 @@
+/*
+ * Simulated Cabinet, host side
+ * WHowe <github.com/whowechina>
+ */
+
+#include "cabinet.h"
+
+#include <string.h>
+
+#include "host.h"
+#include "board_defs.h"
+#include "i2c_scan.h"
+
+#define MPR121_ADDR 0x5A
+#define MPR121_REG_NUM 0x81
+#define MPR121_DATA_END 0x2B // status, filtered data and baseline
+#define MPR121_RESET_REG 0x80
+#define MPR121_OOR_REG 0x02
+#define MPR121_ECR_REG 0x5E
+#define HUB_ADDR 0x70
+#define GP2Y0E_ADDR 0x40
+#define GP2Y0E_DIST_REG 0x5e
+
+static const uint8_t TOF_LIST[] = TOF_MUX_LIST;
+static const uint8_t IR_ABC[] = IR_GROUP_ABC_GPIO;
+
+static struct {
+    uint8_t reg[MPR121_REG_NUM];
+    uint8_t ptr;
+    int ecr_fault;  // ECR reads back as this, if not negative
+    uint16_t oor_fault;
+    unsigned resets;
+} mpr121[3];
+
+static uint8_t hub_mask;
+static uint8_t gp2y0e_ptr;
+static const trace_frame_t *frame;
+
+/* 9 clocks a byte, address included, plus start and stop */
+static uint32_t bus_us(unsigned bytes)
+{
+    return (bytes * 9 + 2) * 1000000 / (I2C_FREQ);
+}
+
+static int mpr121_of(uint8_t addr)
+{
+    int m = addr - MPR121_ADDR;
+    return (m >= 0) && (m < 3) ? m : -1;
+}
+
+/* the one GP2Y0E the hub lets through, -1 for none or a collision */
+static int tof_selected()
+{
+    int found = -1;
+    for (int i = 0; i < sizeof(TOF_LIST); i++) {
+        if (hub_mask & (1 << TOF_LIST[i])) {
+            if (found >= 0) {
+                return -1;
+            }
+            found = i;
+        }
+    }
+    return found;
+}
+
+/* inverse of gp2y0e_dist16_decode(), trace has it times 10 */
+static uint16_t tof_encode(uint16_t dist)
+{
+    uint32_t raw = (dist / 10 * 64 + 9) / 10;
+    return raw > 0xfff ? 0xfff : raw;
+}
+
+static int bus_write(uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    int m = mpr121_of(addr);
+    if ((m >= 0) && len) {
+        uint8_t reg = src[0];
+        for (int i = 1; i < len; i++, reg++) {
+            /* sensor data is read only */
+            if ((reg >= MPR121_DATA_END) && (reg < MPR121_REG_NUM)) {
+                mpr121[m].reg[reg] = src[i];
+            }
+            if ((reg == MPR121_RESET_REG) && (src[i] == 0x63)) {
+                memset(mpr121[m].reg + MPR121_DATA_END, 0,
+                       MPR121_REG_NUM - MPR121_DATA_END);
+                mpr121[m].resets++;
+            }
+        }
+        mpr121[m].ptr = src[0];
+        return len;
+    }
+
+    if (addr == HUB_ADDR) {
+        if (len) {
+            hub_mask = src[len - 1];
+        }
+        return len;
+    }
+
+    if ((addr == GP2Y0E_ADDR) && (tof_selected() >= 0)) {
+        if (len) {
+            gp2y0e_ptr = src[0];
+        }
+        return len;
+    }
+
+    return PICO_ERROR_GENERIC;
+}
+
+static uint8_t mpr121_read(int m, uint8_t reg)
+{
+    if ((reg == MPR121_ECR_REG) && (mpr121[m].ecr_fault >= 0)) {
+        return mpr121[m].ecr_fault;
+    }
+    if ((reg & ~1) == MPR121_OOR_REG) {
+        return mpr121[m].oor_fault >> ((reg & 1) * 8);
+    }
+    return reg < MPR121_REG_NUM ? mpr121[m].reg[reg] : 0;
+}
+
+static int bus_read(uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    int m = mpr121_of(addr);
+    if (m >= 0) {
+        for (int i = 0; i < len; i++) {
+            dst[i] = mpr121_read(m, mpr121[m].ptr++);
+        }
+        return len;
+    }
+
+    if (addr == HUB_ADDR) {
+        memset(dst, hub_mask, len);
+        return len;
+    }
+
+    int tof = tof_selected();
+    if ((addr == GP2Y0E_ADDR) && (tof >= 0)) {
+        uint16_t raw = frame ? tof_encode(frame->tof[tof]) : 0xfff;
+        memset(dst, 0, len);
+        if ((gp2y0e_ptr == GP2Y0E_DIST_REG) && (len >= 2)) {
+            dst[0] = raw >> 4;
+            dst[1] = raw & 0x0f;
+        }
+        return len;
+    }
+
+    memset(dst, 0xff, len); // nobody pulls SDA
+    return PICO_ERROR_GENERIC;
+}
+
+/* a NACK ends it after the address byte */
+static int blocking_write(uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    int ret = bus_write(addr, src, len, nostop);
+    host_time_advance(bus_us(ret > 0 ? 1 + len : 1));
+    return ret;
+}
+
+static int blocking_read(uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    int ret = bus_read(addr, dst, len, nostop);
+    host_time_advance(bus_us(ret > 0 ? 1 + len : 1));
+    return ret;
+}
+
+static const host_i2c_bus_t bus = {
+    .write = blocking_write,
+    .read = blocking_read,
+};
+
+/* Scan engine backend. Data moves at the start, the transaction is over
+   once its bus time has passed, and the IRQ is back on. Whoever waits
+   for it with the IRQ toggling lets time move on. */
+#define WAIT_STEP_US 5
+
+static const i2c_txn_t *current;
+static uint64_t current_end;
+static bool current_ok;
+static bool in_done;
+static bool irq_on;
+static unsigned bus_inits;
+static unsigned bus_inits_irq_on;
+
+static void scan_start(const i2c_txn_t *txn)
+{
+    bool ok = true;
+    unsigned bytes = 1;
+    if (txn->wlen) {
+        ok = bus_write(txn->addr, txn->wbuf, txn->wlen, txn->rlen) == txn->wlen;
+        bytes += ok ? txn->wlen : 0;
+    }
+    if (ok && txn->rlen) {
+        ok = bus_read(txn->addr, txn->rbuf, txn->rlen, false) == txn->rlen;
+        bytes += txn->wlen ? 1 : 0;
+        bytes += ok ? txn->rlen : 0;
+    }
+    current = txn;
+    current_end = time_us_64() + bus_us(bytes);
+    current_ok = ok;
+}
+
+static void scan_abort()
+{
+    current = NULL;
+}
+
+static void scan_irq_enable(bool on)
+{
+    irq_on = on;
+    while (on && current && !in_done) {
+        uint64_t now = time_us_64();
+        if (now < current_end) {
+            uint64_t wait = current_end - now;
+            host_time_advance(wait < WAIT_STEP_US ? wait : WAIT_STEP_US);
+            return;
+        }
+        current = NULL;
+        in_done = true;
+        i2c_scan_done(current_ok);
+        in_done = false;
+    }
+}
+
+static void scan_bus_init(uint32_t baudrate)
+{
+    bus_inits++;
+    bus_inits_irq_on += irq_on;
+}
+
+static const i2c_scan_backend_t scan = {
+    .start = scan_start,
+    .abort = scan_abort,
+    .irq_enable = scan_irq_enable,
+    .bus_init = scan_bus_init,
+};
+
+/* one phase of emitters is lit, each ADC input sees its beam */
+static uint16_t ir_adc(unsigned input)
+{
+    for (int i = 0; i < sizeof(IR_ABC); i++) {
+        if (host_gpio_level(IR_ABC[i])) {
+            return frame ? frame->ir[i * 2 + input] : 0;
+        }
+    }
+    return 0;
+}
+
+void cabinet_init()
+{
+    memset(mpr121, 0, sizeof(mpr121));
+    for (int m = 0; m < 3; m++) {
+        mpr121[m].ecr_fault = -1;
+    }
+    hub_mask = 0;
+    frame = NULL;
+    current = NULL;
+    irq_on = false;
+    host_i2c_attach(&bus);
+    host_adc_source(ir_adc);
+    i2c_scan_use(&scan);
+}
+
+void cabinet_bus_stat(unsigned *inits, unsigned *irq_was_on)
+{
+    *inits = bus_inits;
+    *irq_was_on = bus_inits_irq_on;
+}
+
+void cabinet_fault(unsigned chip, int ecr, uint16_t oor)
+{
+    mpr121[chip].ecr_fault = ecr;
+    mpr121[chip].oor_fault = oor;
+}
+
+unsigned cabinet_resets(unsigned chip)
+{
+    return mpr121[chip].resets;
+}
+
+uint8_t cabinet_reg(unsigned chip, uint8_t reg)
+{
+    return mpr121_read(chip, reg);
+}
+
+void cabinet_show(const trace_frame_t *show, const uint8_t *baseline)
+{
+    frame = show;
+    for (int m = 0; m < 3; m++) {
+        uint8_t *reg = mpr121[m].reg;
+        memcpy(reg, &frame->touched[m], 2);
+        for (int i = 0; i < 12; i++) {
+            int pad = m * 12 + i;
+            uint16_t filtered = pad < TRACE_PAD_NUM ? frame->filtered[pad] : 0;
+            reg[4 + i * 2] = filtered & 0xff;
+            reg[5 + i * 2] = filtered >> 8;
+            reg[0x1e + i] = pad < TRACE_PAD_NUM ? baseline[pad] : 0;
+        }
+    }
+}
@@ -0,0 +1,33 @@
+/*
+ * Simulated Cabinet, host side
+ * WHowe <github.com/whowechina>
+ *
+ * The three MPR121s, the I2C hub with GP2Y0Es behind it and the IR
+ * phototransistors, all showing what the current trace frame says.
+ * Both blocking I2C calls and the scan engine land on it, and the bus
+ * takes as long as it would at I2C_FREQ.
+ */
+
+#ifndef CABINET_H
+#define CABINET_H
+
+#include <stdint.h>
+
+#include "trace.h"
+
+void cabinet_init();
+
+/* baseline is the MPR121 baseline (8-bit), captures don't carry it */
+void cabinet_show(const trace_frame_t *frame, const uint8_t *baseline);
+
+/* A chip going bad: ECR reads back as ecr (negative for what was written)
+   and oor shows as its out-of-range bits */
+void cabinet_fault(unsigned chip, int ecr, uint16_t oor);
+/* Soft resets a chip took, that's one per mpr121_init() */
+unsigned cabinet_resets(unsigned chip);
+uint8_t cabinet_reg(unsigned chip, uint8_t reg);
+
+/* Bus (re)inits through the scan engine, and those with its IRQ on */
+void cabinet_bus_stat(unsigned *inits, unsigned *irq_was_on);
+
+#endif
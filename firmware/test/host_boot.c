@@ -0,0 +1,29 @@
+/*
+ * Host Build Boot
+ * WHowe <github.com/whowechina>
+ */
+
+#include "host_boot.h"
+
+#include <stdbool.h>
+
+#include "config.h"
+#include "save.h"
+#include "rgb.h"
+#include "lights.h"
+#include "analog.h"
+
+void host_boot()
+{
+    static bool booted = false;
+    if (booted) {
+        return;
+    }
+    booted = true;
+
+    config_init();
+    save_init(0, NULL);
+    analog_init();
+    rgb_init();
+    lights_init();
+}
@@ -0,0 +1,12 @@
+/*
+ * Host Build Boot
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef HOST_BOOT_H
+#define HOST_BOOT_H
+
+/* Default config and the modules main() would bring up, once */
+void host_boot();
+
+#endif
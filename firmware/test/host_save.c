@@ -0,0 +1,51 @@
+/*
+ * RAM Only Save for Host Builds
+ * WHowe <github.com/whowechina>
+ *
+ * Modules get their defaults, nothing ever reaches a flash.
+ */
+
+#include "save.h"
+
+#include <string.h>
+
+#define MODULE_MAX 8
+#define DATA_SIZE 1024
+
+static uint8_t data[DATA_SIZE];
+static size_t data_used;
+
+static void (*loaded[MODULE_MAX])();
+static int module_num;
+
+void *save_alloc(size_t size, void *def, void (*after_load)())
+{
+    if ((module_num >= MODULE_MAX) || (data_used + size > DATA_SIZE)) {
+        return NULL;
+    }
+    void *p = data + data_used;
+    memcpy(p, def, size);
+    data_used += size;
+    loaded[module_num++] = after_load;
+    return p;
+}
+
+void save_init(uint32_t magic, mutex_t *lock)
+{
+    for (int i = 0; i < module_num; i++) {
+        loaded[i]();
+    }
+}
+
+void save_request(bool immediately)
+{
+
+}
+
+void save_loop()
+{
+}
+
+void save_hold()
+{
+}
@@ -0,0 +1,58 @@
+/*
+ * LED Delta Report Encoder, host side only
+ * WHowe <github.com/whowechina>
+ *
+ * An unchanged LED costs 3 bytes to carry along, a new run header only 2,
+ * so runs are never merged over gaps. A run that doesn't fit is split.
+ */
+
+#include "led_delta.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+static inline bool changed(const uint8_t *prev, const uint8_t *next, unsigned led)
+{
+    return memcmp(prev + led * 3, next + led * 3, 3) != 0;
+}
+
+int led_delta_encode(const uint8_t *prev, const uint8_t *next, unsigned leds,
+                     uint8_t reports[][LED_DELTA_REPORT_LEN], int max)
+{
+    int num = 0;
+    unsigned used = LED_DELTA_REPORT_LEN; // no report open yet
+
+    unsigned i = 0;
+    while (i < leds) {
+        if (!changed(prev, next, i)) {
+            i++;
+            continue;
+        }
+        unsigned end = i + 1;
+        while ((end < leds) && changed(prev, next, end)) {
+            end++;
+        }
+
+        while (i < end) {
+            if (used + 2 + 3 > LED_DELTA_REPORT_LEN) {
+                if (num == max) {
+                    return -1;
+                }
+                memset(reports[num], 0, LED_DELTA_REPORT_LEN);
+                num++;
+                used = 0;
+            }
+            unsigned n = (LED_DELTA_REPORT_LEN - used - 2) / 3;
+            if (n > end - i) {
+                n = end - i;
+            }
+            uint8_t *run = reports[num - 1] + used;
+            run[0] = i;
+            run[1] = n;
+            memcpy(run + 2, next + i * 3, n * 3);
+            used += 2 + n * 3;
+            i += n;
+        }
+    }
+    return num;
+}
@@ -0,0 +1,20 @@
+/*
+ * LED Delta Report Encoder, host side only
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef LED_DELTA_H
+#define LED_DELTA_H
+
+#include <stdint.h>
+
+/* REPORT_ID_LED_DELTA payload, without the report ID */
+#define LED_DELTA_REPORT_LEN 63
+
+/* Runs of [first LED, LED count, count * 3 BRG bytes] for every LED that
+   differs between prev and next, zero padded reports. Returns how many
+   reports it took, 0 if nothing changed, -1 if more than max. */
+int led_delta_encode(const uint8_t *prev, const uint8_t *next, unsigned leds,
+                     uint8_t reports[][LED_DELTA_REPORT_LEN], int max);
+
+#endif
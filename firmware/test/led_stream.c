@@ -0,0 +1,108 @@
+/*
+ * Synthetic Host LED Stream
+ * WHowe <github.com/whowechina>
+ */
+
+#include "led_stream.h"
+
+#include <string.h>
+
+#define KEY_NUM 16
+#define NOTE_NUM 6
+#define FLASH_FRAMES 32
+
+static uint32_t state;
+
+static struct {
+    uint8_t key;
+    uint8_t width;
+    uint16_t life;
+    uint32_t color;
+} notes[NOTE_NUM];
+
+static uint32_t frame;
+static unsigned flash;
+
+static uint32_t next_rand()
+{
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+void led_stream_init(uint32_t seed)
+{
+    state = seed ? seed : 1;
+    memset(notes, 0, sizeof(notes));
+    frame = 0;
+    flash = 0;
+}
+
+static void put(uint8_t *brg, unsigned led, uint32_t rgb)
+{
+    brg[led * 3] = rgb & 0xff;
+    brg[led * 3 + 1] = (rgb >> 16) & 0xff;
+    brg[led * 3 + 2] = (rgb >> 8) & 0xff;
+}
+
+static uint32_t dim(uint32_t rgb, unsigned level)
+{
+    return ((((rgb >> 16) & 0xff) * level / 256) << 16) |
+           ((((rgb >> 8) & 0xff) * level / 256) << 8) |
+           ((rgb & 0xff) * level / 256);
+}
+
+void led_stream_next(uint8_t brg[LED_STREAM_BYTES])
+{
+    static const uint32_t note_colors[] = { 0xffff00, 0xffffff, 0x00ff40, 0xff40ff };
+    static const uint32_t tower_colors[] = { 0xff0000, 0xff8000, 0xffff00,
+                                             0x00ff00, 0x0080ff, 0x8000ff };
+
+    frame++;
+    if (next_rand() % 12 == 0) {
+        for (int i = 0; i < NOTE_NUM; i++) {
+            if (notes[i].life == 0) {
+                notes[i].width = 1 + next_rand() % 4;
+                notes[i].key = next_rand() % (KEY_NUM - notes[i].width + 1);
+                notes[i].life = 8 + next_rand() % 120;
+                notes[i].color = note_colors[next_rand() % 4];
+                break;
+            }
+        }
+    }
+    if ((flash == 0) && (next_rand() % 400 == 0)) {
+        flash = FLASH_FRAMES;
+    }
+
+    uint32_t keys[KEY_NUM];
+    for (int k = 0; k < KEY_NUM; k++) {
+        keys[k] = 0x101030;
+    }
+    for (int i = 0; i < NOTE_NUM; i++) {
+        if (notes[i].life == 0) {
+            continue;
+        }
+        notes[i].life--;
+        for (int k = notes[i].key; k < notes[i].key + notes[i].width; k++) {
+            keys[k] = notes[i].color;
+        }
+    }
+
+    for (int k = 0; k < KEY_NUM; k++) {
+        put(brg, k * 2, keys[k]);
+    }
+    uint32_t gap = flash ? dim(0xffffff, flash * 256 / FLASH_FRAMES) : 0x400040;
+    for (int g = 0; g < KEY_NUM - 1; g++) {
+        put(brg, g * 2 + 1, gap);
+    }
+    if (flash) {
+        flash--;
+    }
+
+    for (int t = 0; t < LED_STREAM_TOWER; t++) {
+        put(brg, LED_STREAM_SLIDER + t, tower_colors[(frame / 64 + t) % 6]);
+    }
+}
@@ -0,0 +1,24 @@
+/*
+ * Synthetic Host LED Stream
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef LED_STREAM_H
+#define LED_STREAM_H
+
+#include <stdint.h>
+
+#define LED_STREAM_SLIDER 31 // 16 keys and 15 gaps
+#define LED_STREAM_TOWER 6
+#define LED_STREAM_LEDS (LED_STREAM_SLIDER + LED_STREAM_TOWER)
+#define LED_STREAM_BYTES (LED_STREAM_LEDS * 3)
+
+/* Same seed, same frames */
+void led_stream_init(uint32_t seed);
+
+/* Next full frame in BRG order, like chuniio sends during play:
+   notes come and go on the keys, gaps mostly stay, the tower slowly
+   cycles and every now and then the whole slider flashes. */
+void led_stream_next(uint8_t brg[LED_STREAM_BYTES]);
+
+#endif
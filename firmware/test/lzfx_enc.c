@@ -0,0 +1,110 @@
+/*
+ * Lzfx compressor, host side only
+ * WHowe <github.com/whowechina>
+ *
+ * Literal runs [000LLLLL] + L+1 bytes, back references
+ * [LLLooooo oooooooo] or [111ooooo LLLLLLLL oooooooo], same as lzfx.
+ */
+
+#include "lzfx_enc.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "lzfx.h"
+
+#define MAX_LIT 32
+#define MAX_OFF 8192
+#define MAX_REF (7 + 255 + 2)
+#define HASH_BITS 12
+
+static inline unsigned hash3(const uint8_t *p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+int lzfx_compress(const void *ibuf, unsigned int ilen,
+                  void *obuf, unsigned int *olen)
+{
+    const uint8_t *in = ibuf;
+    uint8_t *out = obuf;
+    unsigned int cap = *olen;
+    unsigned int op = 0;
+    unsigned int lit_start = 0;
+    int32_t table[1 << HASH_BITS];
+
+    for (int i = 0; i < (1 << HASH_BITS); i++) {
+        table[i] = -1;
+    }
+
+    unsigned int ip = 0;
+    while (ip < ilen) {
+        unsigned int len = 0;
+        unsigned int off = 0;
+        if (ip + 3 <= ilen) {
+            unsigned h = hash3(in + ip);
+            int32_t cand = table[h];
+            table[h] = ip;
+            if ((cand >= 0) && (ip - cand <= MAX_OFF)) {
+                unsigned int max = ilen - ip < MAX_REF ? ilen - ip : MAX_REF;
+                while ((len < max) && (in[cand + len] == in[ip + len])) {
+                    len++;
+                }
+                off = ip - cand - 1;
+            }
+        }
+
+        if (len < 3) {
+            ip++;
+            if (ip - lit_start == MAX_LIT) {
+                if (op + 1 + MAX_LIT > cap) {
+                    return LZFX_ESIZE;
+                }
+                out[op++] = MAX_LIT - 1;
+                memcpy(out + op, in + lit_start, MAX_LIT);
+                op += MAX_LIT;
+                lit_start = ip;
+            }
+            continue;
+        }
+
+        if (ip > lit_start) {
+            unsigned int n = ip - lit_start;
+            if (op + 1 + n > cap) {
+                return LZFX_ESIZE;
+            }
+            out[op++] = n - 1;
+            memcpy(out + op, in + lit_start, n);
+            op += n;
+        }
+
+        if (op + 3 > cap) {
+            return LZFX_ESIZE;
+        }
+        unsigned int l = len - 2;
+        if (l < 7) {
+            out[op++] = (l << 5) | (off >> 8);
+        } else {
+            out[op++] = (7 << 5) | (off >> 8);
+            out[op++] = l - 7;
+        }
+        out[op++] = off & 0xff;
+
+        ip += len;
+        lit_start = ip;
+    }
+
+    if (ip > lit_start) {
+        unsigned int n = ip - lit_start;
+        if (op + 1 + n > cap) {
+            return LZFX_ESIZE;
+        }
+        out[op++] = n - 1;
+        memcpy(out + op, in + lit_start, n);
+        op += n;
+    }
+
+    *olen = op;
+    return 0;
+}
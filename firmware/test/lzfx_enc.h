@@ -0,0 +1,14 @@
+/*
+ * Lzfx compressor, host side only
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef LZFX_ENC_H
+#define LZFX_ENC_H
+
+/* Greedy, same stream format lzfx_decompress() reads.
+   Returns 0, or LZFX_ESIZE if obuf can't hold it */
+int lzfx_compress(const void *ibuf, unsigned int ilen,
+                  void *obuf, unsigned int *olen);
+
+#endif
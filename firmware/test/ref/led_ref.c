@@ -0,0 +1,174 @@
+/*
+ * Host LED path, as it was before LED words kept the PIO layout
+ * WHowe <github.com/whowechina>
+ *
+ * The data path of rgb.c and the LED part of tud_hid_set_report_cb(),
+ * minus DMA and stats. Words are plain 24-bit color and get shifted
+ * for PIO on every send.
+ */
+
+#include "ref/led_ref.h"
+
+#include <string.h>
+
+#include "pico.h"
+#include "hardware/sync.h"
+#include "board_defs.h"
+#include "config.h"
+#include "lzfx.h"
+
+static uint32_t buf_main[LED_REF_NUM];
+static const uint32_t *buf_tower = &buf_main[31];
+static uint64_t dirty;
+
+static struct {
+    volatile uint32_t seq;
+    volatile uint32_t ack;
+    uint64_t dirty;
+    uint32_t leds[LED_REF_NUM];
+} host_frame;
+
+#if BUTTON_RGB_ORDER == GRB
+#define CHN_R 1
+#define CHN_G 0
+#else
+#define CHN_R 0
+#define CHN_G 1
+#endif
+#define CHN_B 2
+#define CHN_SHIFT(chn) (16 - (chn) * 8)
+
+enum { GROUP_KEY, GROUP_GAP, GROUP_TOWER, GROUP_NUM };
+static uint8_t level_lut[GROUP_NUM][3][256];
+
+static inline unsigned led_group(unsigned index)
+{
+    if (index >= 31) {
+        return GROUP_TOWER;
+    }
+    return (index & 1) ? GROUP_GAP : GROUP_KEY;
+}
+
+void led_ref_init()
+{
+    const uint8_t *fix[GROUP_NUM] = {
+        chu_cfg->color_fix.key, chu_cfg->color_fix.gap, chu_cfg->color_fix.tower
+    };
+    const int chn[3] = { CHN_R, CHN_G, CHN_B };
+    uint32_t level = chu_cfg->style.level;
+
+    for (int i = 0; i < GROUP_NUM; i++) {
+        for (int c = 0; c < 3; c++) {
+            uint32_t scale = level * fix[i][c];
+            for (int v = 0; v < 256; v++) {
+                level_lut[i][chn[c]][v] = v * scale / (255 * 255);
+            }
+        }
+    }
+    memset(buf_main, 0, sizeof(buf_main));
+    memset(&host_frame, 0, sizeof(host_frame));
+    dirty = 0;
+}
+
+static inline void set_led(unsigned index, uint32_t color)
+{
+    if (buf_main[index] != color) {
+        buf_main[index] = color;
+        dirty |= 1ULL << index;
+    }
+}
+
+void led_ref_set_brg(unsigned index, const uint8_t *brg_array, size_t num)
+{
+    if (index >= count_of(buf_main)) {
+        return;
+    }
+    if (index + num > count_of(buf_main)) {
+        num = count_of(buf_main) - index;
+    }
+
+    uint32_t seq = host_frame.seq;
+    host_frame.seq = seq + 1;
+    __dmb();
+
+    uint32_t *leds = &host_frame.leds[index];
+    for (int i = 0; i < num; i++) {
+        const uint8_t (*lut)[256] = level_lut[led_group(index + i)];
+        uint8_t b = brg_array[0];
+        uint8_t r = brg_array[1];
+        uint8_t g = brg_array[2];
+        brg_array += 3;
+        leds[i] = lut[CHN_R][r] << CHN_SHIFT(CHN_R) |
+                  lut[CHN_G][g] << CHN_SHIFT(CHN_G) |
+                  lut[CHN_B][b] << CHN_SHIFT(CHN_B);
+    }
+
+    uint64_t mask = ((1ULL << num) - 1) << index;
+    if (host_frame.ack == seq) {
+        host_frame.dirty = mask;
+    } else {
+        host_frame.dirty |= mask;
+    }
+
+    __dmb();
+    host_frame.seq = seq + 2;
+}
+
+bool led_ref_set_brg_lzfx(const uint8_t *data, unsigned len)
+{
+    uint8_t buf[(48 + 45 + 6) * 3];
+    unsigned int olen = sizeof(buf);
+    if (lzfx_decompress(data, len, buf, &olen) != 0) {
+        return false;
+    }
+    led_ref_set_brg(0, buf, olen / 3);
+    return true;
+}
+
+void led_ref_pull()
+{
+    uint32_t seq = host_frame.seq;
+    uint32_t ack = host_frame.ack;
+    if ((seq == ack) || (seq & 1)) {
+        return;
+    }
+
+    __dmb();
+    uint64_t mask = host_frame.dirty;
+    uint32_t leds[count_of(buf_main)];
+    memcpy(leds, host_frame.leds, sizeof(leds));
+    __dmb();
+
+    if (host_frame.seq != seq) {
+        return;
+    }
+    host_frame.ack = seq;
+
+    for (int i = 0; i < count_of(buf_main); i++) {
+        if (mask & (1ULL << i)) {
+            set_led(i, leds[i]);
+        }
+    }
+}
+
+unsigned led_ref_fill(uint32_t *frame_main, uint32_t *frame_tower)
+{
+    dirty = 0;
+
+    unsigned len = 0;
+    for (int i = 30; i >= 0; i--) {
+        if (chu_cfg->tweak.skip_split_led && (i % 2 == 1)) {
+            continue;
+        }
+        frame_main[len++] = buf_main[i] << 8u;
+    }
+    for (int i = 31; i < count_of(buf_main); i++) {
+        frame_main[len++] = buf_main[i] << 8u;
+    }
+
+    for (int i = 0; i < 6; i++) {
+        frame_main[len++] = buf_tower[i] << 8u;
+        frame_tower[i] = buf_tower[i] << 8u;
+    }
+    return len;
+}
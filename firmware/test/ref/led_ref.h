@@ -0,0 +1,29 @@
+/*
+ * Host LED path, as it was before LED words kept the PIO layout
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef LED_REF_H
+#define LED_REF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LED_REF_NUM 47
+#define LED_REF_FRAME_MAIN (31 + 16 + 6)
+#define LED_REF_FRAME_TOWER 6
+
+/* Level tables from chu_cfg, like rgb_update_level() */
+void led_ref_init();
+
+/* rgb_set_brg(), and the HID callback's stack buffer way for lzfx */
+void led_ref_set_brg(unsigned index, const uint8_t *brg_array, size_t num);
+bool led_ref_set_brg_lzfx(const uint8_t *data, unsigned len);
+
+/* core 1: pull_host(), then what drive_led() put into the DMA frames.
+   Returns the number of words for the main strip. */
+void led_ref_pull();
+unsigned led_ref_fill(uint32_t *frame_main, uint32_t *frame_tower);
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * Lzfx decompressor, as it was before the fast paths
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef LZFX_REF_H
+#define LZFX_REF_H
+
+/* Byte by byte decoder from before the fast paths */
+int lzfx_decompress_ref(const void *ibuf, unsigned int ilen,
+                        void *obuf, unsigned int *olen);
+
+#endif
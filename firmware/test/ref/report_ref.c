@@ -0,0 +1,70 @@
+/*
+ * HID report packing, as it was before the published slider bitmap
+ * WHowe <github.com/whowechina>
+ */
+
+#include "ref/report_ref.h"
+
+#include "class/hid/hid.h"
+#include "board_defs.h"
+
+static const uint8_t keycode_table[128][2] = { HID_ASCII_TO_KEYCODE };
+static const uint8_t keymap[41 + 1] = NKRO_KEYMAP; // 32 keys, 6 air keys, 3 aux, 1 terminator
+
+void gen_joy_report_ref(hid_joy_t *joy, uint16_t airmap, uint16_t aux)
+{
+    joy->axis = 0;
+    for (int i = 0; i < 16; i++) {
+        if (slider_touched_ref(i * 2)) {
+            joy->axis |= 1 << (30 - i * 2);
+        }
+        if (slider_touched_ref(i * 2 + 1)) {
+            joy->axis |= 1 << (31 - i * 2);
+        }
+
+    }
+    joy->axis ^= 0x80808080; // some magic number from CrazyRedMachine
+
+    /* to cope with Redboard mapping which I don't really understand why */
+    joy->buttons = ((airmap >> 1) & 0x07) | ((airmap & 0x01) << 3) | (airmap & 0x30);
+
+    joy->buttons |= (aux & 0x01) ? 0x200 : 0; // START
+    joy->buttons |= (aux & 0x02) ? 0x100 : 0; // SERVICE
+    joy->buttons |= (aux & 0x04) ? 0x1000 : 0; // TEST
+}
+
+void gen_nkro_report_ref(hid_nkro_t *nkro, uint16_t airmap, uint16_t aux)
+{
+    for (int i = 0; i < 32; i++) {
+        uint8_t code = keycode_table[keymap[i]][1];
+        uint8_t byte = code / 8;
+        uint8_t bit = code % 8;
+        if (slider_touched_ref(i)) {
+            nkro->keymap[byte] |= (1 << bit);
+        } else {
+            nkro->keymap[byte] &= ~(1 << bit);
+        }
+    }
+
+    for (int i = 0; i < 6; i++) {
+        uint8_t code = keycode_table[keymap[32 + i]][1];
+        uint8_t byte = code / 8;
+        uint8_t bit = code % 8;
+        if (airmap & (1 << i)) {
+            nkro->keymap[byte] |= (1 << bit);
+        } else {
+            nkro->keymap[byte] &= ~(1 << bit);
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        uint8_t code = keycode_table[keymap[38 + i]][1];
+        uint8_t byte = code / 8;
+        uint8_t bit = code % 8;
+        if (aux & (1 << i)) {
+            nkro->keymap[byte] |= (1 << bit);
+        } else {
+            nkro->keymap[byte] &= ~(1 << bit);
+        }
+    }
+}
@@ -0,0 +1,23 @@
+/*
+ * HID report packing, as it was before the published slider bitmap
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef REPORT_REF_H
+#define REPORT_REF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "report.h"
+
+/* slider.c kept the three MPR121 touch words and answered per pad */
+void slider_ref_set(const uint16_t touch[3]);
+bool slider_touched_ref(unsigned key);
+
+/* gen_joy_report() and gen_nkro_report() from main.c, with the sensor
+   reads passed in. NKRO uses the built-in NKRO_KEYMAP like it did. */
+void gen_joy_report_ref(hid_joy_t *joy, uint16_t airmap, uint16_t aux);
+void gen_nkro_report_ref(hid_nkro_t *nkro, uint16_t airmap, uint16_t aux);
+
+#endif
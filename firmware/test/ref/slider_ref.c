@@ -0,0 +1,25 @@
+/*
+ * Slider touch words, as they were before the published slider bitmap
+ * WHowe <github.com/whowechina>
+ *
+ * Own file on purpose, main.c had to call into slider.c for every pad.
+ */
+
+#include "ref/report_ref.h"
+
+static uint16_t touch[3];
+
+void slider_ref_set(const uint16_t words[3])
+{
+    touch[0] = words[0];
+    touch[1] = words[1];
+    touch[2] = words[2];
+}
+
+bool slider_touched_ref(unsigned key)
+{
+    if (key >= 32) {
+        return 0;
+    }
+    return touch[key / 12] & (1 << (key % 12));
+}
@@ -0,0 +1,405 @@
+/*
+ * Sensor Trace Replay Harness
+ * WHowe <github.com/whowechina>
+ *
+ * Feeds traces through slider.c and air.c, as they are, on a simulated
+ * cabinet and scores what comes out. Without arguments it runs scripted
+ * synthetic traces against their ground truth. Capture files given as
+ * arguments are replayed and summarized instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "host.h"
+#include "host_boot.h"
+#include "cabinet.h"
+#include "trace_file.h"
+#include "trace_synth.h"
+
+#include "board_defs.h"
+#include "config.h"
+#include "slider.h"
+#include "air.h"
+#include "i2c_scan.h"
+#include "profile.h"
+
+#define FRAME_MAX 6000
+#define KEY_NUM 16
+#define AIR_NUM 6
+#define SCAN_MARGIN_US 100 // same as main.c
+#define BLIP_FRAMES 3       // shorter presses are most likely noise
+/* software touch gets each chip's analog data every third loop, and
+   loops run over 1ms when ToF shares the bus */
+#define SOFT_LATENCY_FRAMES 4
+
+static const char *mode_names[] = { "mpr121", "soft" };
+
+static trace_frame_t frames[FRAME_MAX];
+static uint8_t baseline[TRACE_PAD_NUM];
+static bool analog_scan; // as with "trace start" on the device
+static bool profile_flips;
+
+int test_failures;
+
+typedef struct {
+    int presses;
+    int blips;
+    int false_presses; // nothing was there
+    int missed;
+    int latency_num;
+    int latency_sum;   // frames
+    int latency_max;
+} score_t;
+
+typedef struct {
+    uint32_t last;
+    uint32_t since[KEY_NUM];
+    int found[SYNTH_FINGER_MAX > SYNTH_HAND_MAX ? SYNTH_FINGER_MAX : SYNTH_HAND_MAX];
+} track_t;
+
+static void boot(bool ir, int touch_mode)
+{
+    host_boot();
+    host_time_step(0);
+    chu_cfg->ir.enabled = ir;
+    chu_cfg->tweak.touch_mode = touch_mode;
+    cabinet_init();
+    cabinet_show(&frames[0], baseline);
+    slider_init();
+    air_init();
+    slider_analog_scan(analog_scan);
+
+    /* ToF to IR and back at runtime, as SERVICE+START does */
+    if (profile_flips) {
+        static bool profile_ready = false;
+        if (!profile_ready) {
+            profile_init();
+            profile_ready = true;
+        }
+        profile_reset();
+        profile_switch(2);
+        chu_cfg->ir.enabled = 1;
+        profile_switch(0);
+        profile_switch(2);
+        profile_switch(0);
+        CHECK_EQ(chu_cfg->ir.enabled, 0);
+    }
+}
+
+/* The sensing part of core0_loop() in main.c. The bus takes its time,
+   a frame that comes while the last loop still runs goes unseen. */
+static void run_frame(const trace_frame_t *frame, uint64_t start_us)
+{
+    uint64_t at = start_us + frame->time_us;
+    if (time_us_64() > at) {
+        return;
+    }
+    cabinet_show(frame, baseline);
+    host_time_set(at);
+
+    slider_scan();
+    air_scan();
+    uint32_t scan_us = i2c_scan_bus_us(I2C_FREQ) + SCAN_MARGIN_US;
+    i2c_scan_start();
+    i2c_scan_sync(scan_us);
+    slider_update();
+    air_update();
+}
+
+static uint32_t key_bitmap()
+{
+    uint32_t pads = slider_bitmap();
+    uint32_t keys = 0;
+    for (int k = 0; k < KEY_NUM; k++) {
+        if (pads & (3 << (k * 2))) {
+            keys |= 1 << k;
+        }
+    }
+    return keys;
+}
+
+/* Counts press edges and blips, returns what got pressed just now */
+static uint32_t track(score_t *score, track_t *t, uint32_t now, int num, int f)
+{
+    uint32_t pressed = now & ~t->last;
+    uint32_t released = t->last & ~now;
+    for (int i = 0; i < num; i++) {
+        if (pressed & (1 << i)) {
+            score->presses++;
+            t->since[i] = f;
+        }
+        if ((released & (1 << i)) && (f - t->since[i] < BLIP_FRAMES)) {
+            score->blips++;
+        }
+    }
+    t->last = now;
+    return pressed;
+}
+
+/* found[] is the detection latency of each finger or hand, -1 until then */
+static void settle(score_t *score, int *found, bool over)
+{
+    if (*found >= 0) {
+        score->latency_num++;
+        score->latency_sum += *found;
+        score->latency_max = *found > score->latency_max ? *found : score->latency_max;
+    } else if (over) {
+        score->missed++;
+    }
+}
+
+/* A finger is over one key, the keys next to it count as truth too */
+static void judge_keys(const synth_script_t *script, score_t *score,
+                       track_t *t, uint32_t keys, uint32_t pressed, int f)
+{
+    uint32_t near = 0;
+    for (int k = 0; k < script->finger_num; k++) {
+        const synth_finger_t *finger = &script->finger[k];
+        int pos = synth_finger_pos(finger, f);
+        if (pos < 0) {
+            continue;
+        }
+        int key = pos / 512;
+        near |= (7u << key) >> 1;
+        if ((t->found[k] < 0) && (keys & (1 << key))) {
+            t->found[k] = f - finger->from;
+            settle(score, &t->found[k], false);
+        }
+    }
+    score->false_presses += __builtin_popcount(pressed & ~near);
+}
+
+static void judge_air(const synth_script_t *script, score_t *score,
+                      track_t *t, uint32_t air, uint32_t pressed, int f)
+{
+    bool there = false;
+    for (int k = 0; k < script->hand_num; k++) {
+        const synth_hand_t *hand = &script->hand[k];
+        int level = synth_hand_level(hand, f);
+        if (level < 0) {
+            continue;
+        }
+        there = true;
+        if ((t->found[k] < 0) && (air & (1 << level))) {
+            t->found[k] = f - hand->from;
+            settle(score, &t->found[k], false);
+        }
+    }
+    if (!there) {
+        score->false_presses += __builtin_popcount(pressed);
+    }
+}
+
+/* script is NULL for captures, then there is no truth to judge by */
+static void replay(const synth_script_t *script, int num, bool ir,
+                   int touch_mode, score_t *keys, score_t *air)
+{
+    memset(keys, 0, sizeof(*keys));
+    memset(air, 0, sizeof(*air));
+    track_t key_track = { 0 };
+    track_t air_track = { 0 };
+    memset(key_track.found, -1, sizeof(key_track.found));
+    memset(air_track.found, -1, sizeof(air_track.found));
+
+    static uint64_t clock = 0; // keeps running over replays
+    boot(ir, touch_mode);
+    uint64_t start = clock + 100000;
+
+    for (int f = 0; f < num; f++) {
+        run_frame(&frames[f], start);
+        uint32_t key_now = key_bitmap();
+        uint32_t air_now = air_bitmap();
+        uint32_t key_pressed = track(keys, &key_track, key_now, KEY_NUM, f);
+        uint32_t air_pressed = track(air, &air_track, air_now, AIR_NUM, f);
+        if (script) {
+            judge_keys(script, keys, &key_track, key_now, key_pressed, f);
+            judge_air(script, air, &air_track, air_now, air_pressed, f);
+        }
+    }
+    clock = start + frames[num - 1].time_us;
+
+    if (script) {
+        for (int k = 0; k < script->finger_num; k++) {
+            if (key_track.found[k] < 0) {
+                settle(keys, &key_track.found[k], true);
+            }
+        }
+        for (int k = 0; k < script->hand_num; k++) {
+            if (air_track.found[k] < 0) {
+                settle(air, &air_track.found[k], true);
+            }
+        }
+    }
+}
+
+static void print_score(const char *name, const char *what, const score_t *s,
+                        bool truth)
+{
+    printf("%-10s %-11s %5d %5d", name, what, s->presses, s->blips);
+    if (truth) {
+        printf(" %5d %5d", s->false_presses, s->missed);
+        if (s->latency_num) {
+            printf("  %4.1f/%d", (double)s->latency_sum / s->latency_num,
+                   s->latency_max);
+        }
+    }
+    printf("\n");
+}
+
+static void print_header(bool truth)
+{
+    printf("%-10s %-11s %5s %5s", "trace", "detector", "press", "blip");
+    if (truth) {
+        printf(" %5s %5s  %s", "false", "miss", "latency avg/max (frames)");
+    }
+    printf("\n");
+}
+
+/* a tap on every other key, then a few hands in the air */
+static void script_taps(synth_script_t *script, bool ir)
+{
+    memset(script, 0, sizeof(*script));
+    script->seed = 11;
+    script->noise = 3;
+    script->ir = ir;
+    script->air_noise = ir ? 60 : 20;
+    script->finger_num = SYNTH_FINGER_MAX;
+    for (int i = 0; i < SYNTH_FINGER_MAX; i++) {
+        int pad = (i * 8 + 3) % TRACE_PAD_NUM;
+        script->finger[i] = (synth_finger_t){ 200 + i * 300, 300 + i * 300,
+                                              SYNTH_PAD(pad), SYNTH_PAD(pad), 60 };
+    }
+    script->hand_num = AIR_NUM;
+    for (int i = 0; i < AIR_NUM; i++) {
+        script->hand[i] = (synth_hand_t){ 1600 + i * 300, 1700 + i * 300, i };
+    }
+}
+
+static bool check_clean(const char *name, const score_t *keys, const score_t *air,
+                        int key_latency, int air_latency)
+{
+    int before = test_failures;
+    CHECK_EQ(keys->false_presses, 0);
+    CHECK_EQ(keys->missed, 0);
+    CHECK_EQ(keys->blips, 0);
+    CHECK(keys->latency_max <= key_latency);
+    CHECK_EQ(air->false_presses, 0);
+    CHECK_EQ(air->missed, 0);
+    CHECK(air->latency_max <= air_latency);
+    if (test_failures != before) {
+        printf("%s: above checks failed\n", name);
+    }
+    return test_failures == before;
+}
+
+static void run_synthetic()
+{
+    synth_script_t script;
+    score_t keys, air;
+
+    print_header(true);
+    for (int ir = 0; ir < 2; ir++) {
+        script_taps(&script, ir);
+        const int num = 3600;
+        synth_trace(&script, frames, num, baseline);
+        const char *name = ir ? "taps-ir" : "taps-tof";
+        for (int mode = 0; mode < 2; mode++) {
+            replay(&script, num, ir, mode, &keys, &air);
+            print_score(name, mode_names[mode], &keys, true);
+            print_score(name, ir ? "ir" : "tof", &air, true);
+            /* IR reads one of three beam groups per frame */
+            check_clean(name, &keys, &air, mode ? SOFT_LATENCY_FRAMES : 0,
+                        ir ? 2 : 0);
+        }
+    }
+
+    /* capturing a trace adds analog reads, input must keep flowing */
+    script_taps(&script, false);
+    synth_trace(&script, frames, 3600, baseline);
+    analog_scan = true;
+    replay(&script, 3600, false, 0, &keys, &air);
+    analog_scan = false;
+    print_score("tracing", mode_names[0], &keys, true);
+    print_score("tracing", "tof", &air, true);
+    check_clean("tracing", &keys, &air, 0, 0);
+
+    /* air sensors re-initialized by profile switches are found again,
+       the bus came up again with the scan IRQ off */
+    unsigned inits, irq_on;
+    cabinet_bus_stat(&inits, &irq_on);
+    profile_flips = true;
+    replay(&script, 3600, false, 0, &keys, &air);
+    profile_flips = false;
+    print_score("profiles", mode_names[0], &keys, true);
+    print_score("profiles", "tof", &air, true);
+    check_clean("profiles", &keys, &air, 0, 0);
+    unsigned inits_now, irq_on_now;
+    cabinet_bus_stat(&inits_now, &irq_on_now);
+    CHECK_EQ(inits_now - inits, 4); // slider, air, and air twice more
+    CHECK_EQ(irq_on_now, 0);
+
+    /* noisy pads with spikes, both touch detectors side by side */
+    script_taps(&script, false);
+    script.noise = 6;
+    script.spike = 30;
+    script.spike_rate = 10;
+    const int num = 1500;
+    synth_trace(&script, frames, num, baseline);
+    score_t hw, soft;
+    replay(&script, num, false, 0, &hw, &air);
+    print_score("spiky", mode_names[0], &hw, true);
+    replay(&script, num, false, 1, &soft, &air);
+    print_score("spiky", mode_names[1], &soft, true);
+    CHECK(hw.false_presses > 0); // the harness does see them
+    CHECK_EQ(soft.missed, 0);
+    CHECK(soft.false_presses < hw.false_presses);
+}
+
+static int run_capture(const char *path)
+{
+    trace_frame_t *capture;
+    int num = trace_load(path, &capture);
+    if (num <= 0) {
+        printf("%s: no frames\n", path);
+        return 1;
+    }
+    if (num > FRAME_MAX) {
+        printf("%s: only the first %d of %d frames\n", path, FRAME_MAX, num);
+        num = FRAME_MAX;
+    }
+    memcpy(frames, capture, num * sizeof(*frames));
+    free(capture);
+    trace_baseline(frames, num, baseline);
+
+    bool ir = frames[0].flags & TRACE_FLAG_IR;
+    const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    printf("%s: %d frames, %.1f s\n", path, num,
+           (frames[num - 1].time_us - frames[0].time_us) / 1e6);
+    print_header(false);
+    for (int mode = 0; mode < 2; mode++) {
+        score_t keys, air;
+        replay(NULL, num, ir, mode, &keys, &air);
+        print_score(name, mode_names[mode], &keys, false);
+        if (mode == 0) {
+            print_score(name, ir ? "ir" : "tof", &air, false);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        int fail = 0;
+        for (int i = 1; i < argc; i++) {
+            fail |= run_capture(argv[i]);
+        }
+        return fail;
+    }
+
+    run_synthetic();
+    return test_result("replay");
+}
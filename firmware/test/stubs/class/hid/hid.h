@@ -0,0 +1,33 @@
+/*
+ * Host build stand-in for TinyUSB class/hid/hid.h
+ * WHowe <github.com/whowechina>
+ *
+ * Only what the firmware uses, values as in TinyUSB.
+ */
+
+#ifndef _TUSB_HID_H_
+#define _TUSB_HID_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* {shift, keycode} for each 7-bit ASCII char */
+#define HID_ASCII_TO_KEYCODE \
+    {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, \
+    {0, 0x2a}, {0, 0x2b}, {0, 0x28}, {0, 0x00}, {0, 0x00}, {0, 0x28}, {0, 0x00}, {0, 0x00}, \
+    {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, \
+    {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x29}, {0, 0x00}, {0, 0x00}, {0, 0x00}, {0, 0x00}, \
+    {0, 0x2c}, {1, 0x1e}, {1, 0x34}, {1, 0x20}, {1, 0x21}, {1, 0x22}, {1, 0x24}, {0, 0x34}, \
+    {1, 0x26}, {1, 0x27}, {1, 0x25}, {1, 0x2e}, {0, 0x36}, {0, 0x2d}, {0, 0x37}, {0, 0x38}, \
+    {0, 0x27}, {0, 0x1e}, {0, 0x1f}, {0, 0x20}, {0, 0x21}, {0, 0x22}, {0, 0x23}, {0, 0x24}, \
+    {0, 0x25}, {0, 0x26}, {1, 0x33}, {0, 0x33}, {1, 0x36}, {0, 0x2e}, {1, 0x37}, {1, 0x38}, \
+    {1, 0x1f}, {1, 0x04}, {1, 0x05}, {1, 0x06}, {1, 0x07}, {1, 0x08}, {1, 0x09}, {1, 0x0a}, \
+    {1, 0x0b}, {1, 0x0c}, {1, 0x0d}, {1, 0x0e}, {1, 0x0f}, {1, 0x10}, {1, 0x11}, {1, 0x12}, \
+    {1, 0x13}, {1, 0x14}, {1, 0x15}, {1, 0x16}, {1, 0x17}, {1, 0x18}, {1, 0x19}, {1, 0x1a}, \
+    {1, 0x1b}, {1, 0x1c}, {1, 0x1d}, {0, 0x2f}, {0, 0x31}, {0, 0x30}, {1, 0x23}, {1, 0x2d}, \
+    {0, 0x35}, {0, 0x04}, {0, 0x05}, {0, 0x06}, {0, 0x07}, {0, 0x08}, {0, 0x09}, {0, 0x0a}, \
+    {0, 0x0b}, {0, 0x0c}, {0, 0x0d}, {0, 0x0e}, {0, 0x0f}, {0, 0x10}, {0, 0x11}, {0, 0x12}, \
+    {0, 0x13}, {0, 0x14}, {0, 0x15}, {0, 0x16}, {0, 0x17}, {0, 0x18}, {0, 0x19}, {0, 0x1a}, \
+    {0, 0x1b}, {0, 0x1c}, {0, 0x1d}, {1, 0x2f}, {1, 0x31}, {1, 0x30}, {1, 0x35}, {0, 0x4c},
+
+#endif
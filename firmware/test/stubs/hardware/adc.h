@@ -0,0 +1,18 @@
+/*
+ * Host build stand-in for hardware/adc.h
+ * WHowe <github.com/whowechina>
+ *
+ * Conversions come from whatever host_adc_source() was given.
+ */
+
+#ifndef _HARDWARE_ADC_H
+#define _HARDWARE_ADC_H
+
+#include "pico.h"
+
+void adc_init();
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+uint16_t adc_read();
+
+#endif
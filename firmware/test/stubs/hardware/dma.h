@@ -0,0 +1,57 @@
+/*
+ * Host build stand-in for hardware/dma.h
+ * WHowe <github.com/whowechina>
+ *
+ * A started channel "transfers" at once: its data is captured for the
+ * test and its IRQ 0 fires right away if enabled, see host.h.
+ */
+
+#ifndef _HARDWARE_DMA_H
+#define _HARDWARE_DMA_H
+
+#include "pico.h"
+
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct {
+    uint32_t ctrl;
+} dma_channel_config;
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c,
+                                                         enum dma_channel_transfer_size size)
+{
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint transfer_count, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_start_channel_mask(uint32_t chan_mask);
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+bool dma_channel_get_irq0_status(uint channel);
+void dma_channel_acknowledge_irq0(uint channel);
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * Host build stand-in for hardware/flash.h
+ * WHowe <github.com/whowechina>
+ *
+ * Flash is a buffer that behaves like NOR: erase sets a sector to 0xff,
+ * program can only clear bits. See host.h for power cuts.
+ */
+
+#ifndef _HARDWARE_FLASH_H
+#define _HARDWARE_FLASH_H
+
+#include "pico.h"
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+uint8_t *host_flash_image();
+#define XIP_BASE ((uintptr_t)host_flash_image())
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif
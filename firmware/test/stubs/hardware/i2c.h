@@ -0,0 +1,33 @@
+/*
+ * Host build stand-in for hardware/i2c.h
+ * WHowe <github.com/whowechina>
+ *
+ * Blocking calls go to whatever host_i2c_attach() was given.
+ */
+
+#ifndef _HARDWARE_I2C_H
+#define _HARDWARE_I2C_H
+
+#include "pico.h"
+#include "hardware/timer.h"
+
+typedef struct i2c_inst {
+    int index;
+} i2c_inst_t;
+
+extern i2c_inst_t host_i2c[2];
+#define i2c0 (&host_i2c[0])
+#define i2c1 (&host_i2c[1])
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                       size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+                      size_t len, bool nostop);
+int i2c_write_blocking_until(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                             size_t len, bool nostop, absolute_time_t until);
+int i2c_read_blocking_until(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+                            size_t len, bool nostop, absolute_time_t until);
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * Host build stand-in for hardware/irq.h
+ * WHowe <github.com/whowechina>
+ *
+ * Handlers are only called through host_irq_fire().
+ */
+
+#ifndef _HARDWARE_IRQ_H
+#define _HARDWARE_IRQ_H
+
+#include "pico.h"
+
+#define DMA_IRQ_0 11
+#define DMA_IRQ_1 12
+#define IO_IRQ_BANK0 13
+#define I2C0_IRQ 23
+#define I2C1_IRQ 24
+#define IRQ_NUM 32
+
+typedef void (*irq_handler_t)();
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+#endif
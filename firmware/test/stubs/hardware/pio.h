@@ -0,0 +1,29 @@
+/*
+ * Host build stand-in for hardware/pio.h
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef _HARDWARE_PIO_H
+#define _HARDWARE_PIO_H
+
+#include "pico.h"
+
+typedef struct {
+    volatile uint32_t txf[4];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t host_pio[2];
+#define pio0 (&host_pio[0])
+#define pio1 (&host_pio[1])
+
+typedef struct {
+    const uint16_t *instructions;
+    uint8_t length;
+} pio_program_t;
+
+uint pio_add_program(PIO pio, const pio_program_t *program);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Host build stand-in for hardware/sync.h
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef _HARDWARE_SYNC_H
+#define _HARDWARE_SYNC_H
+
+#include "pico.h"
+
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
+
+static inline void __wfe()
+{
+}
+
+static inline void __sev()
+{
+}
+
+#endif
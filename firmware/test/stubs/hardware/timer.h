@@ -0,0 +1,41 @@
+/*
+ * Host build stand-in for hardware/timer.h
+ * WHowe <github.com/whowechina>
+ *
+ * Time is simulated, see host.h.
+ */
+
+#ifndef _HARDWARE_TIMER_H
+#define _HARDWARE_TIMER_H
+
+#include "pico.h"
+
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64();
+uint32_t time_us_32();
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+static inline absolute_time_t get_absolute_time()
+{
+    return time_us_64();
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us)
+{
+    return time_us_64() + us;
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+    return time_us_64() + ms * 1000ULL;
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t)
+{
+    return t;
+}
+
+#endif
@@ -0,0 +1,450 @@
+/*
+ * Host Side of the SDK Stubs
+ * WHowe <github.com/whowechina>
+ *
+ * Minimal fake of the RP2040 pieces the firmware touches, enough to run
+ * the hardware independent modules and their callers on a PC.
+ */
+
+#include "host.h"
+
+#include <string.h>
+
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/flash.h"
+#include "hardware/i2c.h"
+#include "hardware/gpio.h"
+#include "hardware/adc.h"
+#include "pico/multicore.h"
+#include "pico/unique_id.h"
+#include "pico/bootrom.h"
+#include "ws2812.pio.h"
+
+/* time */
+static uint64_t now_us;
+static uint32_t step_us;
+
+void host_time_set(uint64_t us)
+{
+    now_us = us;
+}
+
+void host_time_advance(uint64_t us)
+{
+    now_us += us;
+}
+
+void host_time_step(uint32_t us)
+{
+    step_us = us;
+}
+
+uint64_t time_us_64()
+{
+    uint64_t t = now_us;
+    now_us += step_us;
+    return t;
+}
+
+uint32_t time_us_32()
+{
+    return (uint32_t)time_us_64();
+}
+
+void sleep_us(uint64_t us)
+{
+    now_us += us;
+}
+
+void sleep_ms(uint32_t ms)
+{
+    now_us += ms * 1000ULL;
+}
+
+/* interrupts */
+static irq_handler_t irq_handlers[IRQ_NUM];
+static uint32_t irq_enabled;
+static bool irq_disabled;
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    irq_handlers[num] = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    if (enabled) {
+        irq_enabled |= 1u << num;
+    } else {
+        irq_enabled &= ~(1u << num);
+    }
+}
+
+void host_irq_fire(unsigned num)
+{
+    if (!irq_disabled && (irq_enabled & (1u << num)) && irq_handlers[num]) {
+        irq_handlers[num]();
+    }
+}
+
+uint32_t save_and_disable_interrupts()
+{
+    uint32_t status = irq_disabled;
+    irq_disabled = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    irq_disabled = status;
+}
+
+/* PIO */
+pio_hw_t host_pio[2];
+const pio_program_t ws2812_program = { 0 };
+
+uint pio_add_program(PIO pio, const pio_program_t *program)
+{
+    return 0;
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx)
+{
+    return sm;
+}
+
+void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw)
+{
+}
+
+/* DMA, every transfer completes the moment it starts */
+static struct {
+    bool claimed;
+    bool irq0_enabled;
+    bool irq0_status;
+    const uint32_t *read_addr;
+    uint32_t count;
+    uint32_t starts;
+    uint32_t last[64];
+    uint32_t last_count;
+} dma[NUM_DMA_CHANNELS];
+
+int dma_claim_unused_channel(bool required)
+{
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (!dma[i].claimed) {
+            dma[i].claimed = true;
+            return i;
+        }
+    }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    return (dma_channel_config) { 0 };
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint transfer_count, bool trigger)
+{
+    dma[channel].read_addr = (const uint32_t *)read_addr;
+    dma[channel].count = transfer_count;
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger)
+{
+    dma[channel].read_addr = (const uint32_t *)read_addr;
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger)
+{
+    dma[channel].count = trans_count;
+}
+
+void dma_start_channel_mask(uint32_t chan_mask)
+{
+    bool fire = false;
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (!(chan_mask & (1u << i))) {
+            continue;
+        }
+        uint32_t count = dma[i].count;
+        if (count > count_of(dma[i].last)) {
+            count = count_of(dma[i].last);
+        }
+        memcpy(dma[i].last, dma[i].read_addr, count * 4);
+        dma[i].last_count = count;
+        dma[i].starts++;
+        if (dma[i].irq0_enabled) {
+            dma[i].irq0_status = true;
+            fire = true;
+        }
+    }
+    if (fire) {
+        host_irq_fire(DMA_IRQ_0);
+    }
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled)
+{
+    dma[channel].irq0_enabled = enabled;
+}
+
+bool dma_channel_get_irq0_status(uint channel)
+{
+    return dma[channel].irq0_status;
+}
+
+void dma_channel_acknowledge_irq0(uint channel)
+{
+    dma[channel].irq0_status = false;
+}
+
+const uint32_t *host_dma_last(unsigned channel, unsigned *count)
+{
+    *count = dma[channel].last_count;
+    return dma[channel].last;
+}
+
+uint32_t host_dma_starts(unsigned channel)
+{
+    return dma[channel].starts;
+}
+
+/* single threaded, nobody else ever holds a mutex */
+void mutex_init(mutex_t *mtx)
+{
+    mtx->owned = false;
+}
+
+bool mutex_try_enter(mutex_t *mtx, uint32_t *owner_out)
+{
+    if (mtx->owned) {
+        return false;
+    }
+    mtx->owned = true;
+    return true;
+}
+
+bool mutex_enter_timeout_us(mutex_t *mtx, uint32_t timeout_us)
+{
+    if (mtx->owned) {
+        sleep_us(timeout_us);
+        return false;
+    }
+    mtx->owned = true;
+    return true;
+}
+
+void mutex_exit(mutex_t *mtx)
+{
+    mtx->owned = false;
+}
+
+/* I2C */
+i2c_inst_t host_i2c[2] = { { 0 }, { 1 } };
+static const host_i2c_bus_t *i2c_bus;
+
+void host_i2c_attach(const host_i2c_bus_t *bus)
+{
+    i2c_bus = bus;
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                       size_t len, bool nostop)
+{
+    return i2c_bus ? i2c_bus->write(addr, src, len, nostop) : PICO_ERROR_GENERIC;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+                      size_t len, bool nostop)
+{
+    return i2c_bus ? i2c_bus->read(addr, dst, len, nostop) : PICO_ERROR_GENERIC;
+}
+
+int i2c_write_blocking_until(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src,
+                             size_t len, bool nostop, absolute_time_t until)
+{
+    return i2c_write_blocking(i2c, addr, src, len, nostop);
+}
+
+int i2c_read_blocking_until(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst,
+                            size_t len, bool nostop, absolute_time_t until)
+{
+    return i2c_read_blocking(i2c, addr, dst, len, nostop);
+}
+
+/* GPIO */
+static uint32_t gpio_out;
+static uint32_t gpio_in = ~0u;
+static uint32_t gpio_dir;
+
+void host_gpio_set(unsigned gpio, bool level)
+{
+    gpio_in = level ? (gpio_in | (1u << gpio)) : (gpio_in & ~(1u << gpio));
+}
+
+bool host_gpio_level(unsigned gpio)
+{
+    return gpio_out & (1u << gpio);
+}
+
+void gpio_init(uint gpio)
+{
+    gpio_dir &= ~(1u << gpio);
+    gpio_out &= ~(1u << gpio);
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    gpio_dir = out ? (gpio_dir | (1u << gpio)) : (gpio_dir & ~(1u << gpio));
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+}
+
+void gpio_pull_up(uint gpio)
+{
+}
+
+void gpio_pull_down(uint gpio)
+{
+}
+
+void gpio_set_drive_strength(uint gpio, enum gpio_drive_strength drive)
+{
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    gpio_out = value ? (gpio_out | (1u << gpio)) : (gpio_out & ~(1u << gpio));
+}
+
+bool gpio_get(uint gpio)
+{
+    uint32_t levels = (gpio_dir & (1u << gpio)) ? gpio_out : gpio_in;
+    return levels & (1u << gpio);
+}
+
+/* ADC */
+static uint16_t (*adc_source)(unsigned input);
+static unsigned adc_input;
+
+void host_adc_source(uint16_t (*source)(unsigned input))
+{
+    adc_source = source;
+}
+
+void adc_init()
+{
+}
+
+void adc_gpio_init(uint gpio)
+{
+}
+
+void adc_select_input(uint input)
+{
+    adc_input = input;
+}
+
+uint16_t adc_read()
+{
+    return adc_source ? adc_source(adc_input) & 0xfff : 0;
+}
+
+/* NOR flash */
+static uint8_t default_flash[PICO_FLASH_SIZE_BYTES];
+static uint8_t *host_flash = NULL;
+static int cut_after = -1;
+static void (*cut_func)();
+static host_flash_stat_t flash_stat;
+
+void host_flash_use(uint8_t *image)
+{
+    host_flash = image;
+}
+
+void host_flash_cut(int n, void (*power_cut)())
+{
+    cut_after = n;
+    cut_func = power_cut;
+}
+
+void host_flash_stat(host_flash_stat_t *stat)
+{
+    *stat = flash_stat;
+}
+
+uint8_t *host_flash_image()
+{
+    if (!host_flash) {
+        memset(default_flash, 0xff, sizeof(default_flash));
+        host_flash = default_flash;
+    }
+    return host_flash;
+}
+
+/* true if this op is the one to be cut */
+static bool flash_cut_now()
+{
+    if (cut_after < 0) {
+        return false;
+    }
+    return cut_after-- == 0;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    assert(flash_offs % FLASH_SECTOR_SIZE == 0);
+    assert(count % FLASH_SECTOR_SIZE == 0);
+    assert(flash_offs + count <= PICO_FLASH_SIZE_BYTES);
+
+    uint8_t *p = host_flash_image() + flash_offs;
+    if (flash_cut_now()) {
+        memset(p, 0xff, count / 2);
+        cut_func();
+    }
+    memset(p, 0xff, count);
+    flash_stat.erases += count / FLASH_SECTOR_SIZE;
+    now_us += HOST_FLASH_ERASE_US * (count / FLASH_SECTOR_SIZE);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    assert(flash_offs % FLASH_PAGE_SIZE == 0);
+    assert(count % FLASH_PAGE_SIZE == 0);
+    assert(flash_offs + count <= PICO_FLASH_SIZE_BYTES);
+
+    uint8_t *p = host_flash_image() + flash_offs;
+    size_t n = flash_cut_now() ? count / 2 : count;
+    for (size_t i = 0; i < n; i++) {
+        p[i] &= data[i];
+    }
+    if (n < count) {
+        cut_func();
+    }
+    flash_stat.programs += count / FLASH_PAGE_SIZE;
+    now_us += HOST_FLASH_PROGRAM_US * (count / FLASH_PAGE_SIZE);
+}
+
+void pico_get_unique_board_id(pico_unique_board_id_t *id_out)
+{
+    memset(id_out->id, 0x5a, sizeof(id_out->id));
+}
+
+void reset_usb_boot(uint32_t usb_activity_gpio_pin_mask, uint32_t disable_interface_mask)
+{
+}
@@ -0,0 +1,63 @@
+/*
+ * Host Side of the SDK Stubs
+ * WHowe <github.com/whowechina>
+ *
+ * What tests and benchmarks use to drive the fake hardware.
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Simulated clock, sleeps advance it, every read adds time_step */
+void host_time_set(uint64_t us);
+void host_time_advance(uint64_t us);
+void host_time_step(uint32_t us);
+
+/* Calls the handler if the IRQ is enabled */
+void host_irq_fire(unsigned num);
+
+/* Words of the last transfer started on a DMA channel */
+const uint32_t *host_dma_last(unsigned channel, unsigned *count);
+uint32_t host_dma_starts(unsigned channel);
+
+/* Blocking I2C calls land here, return bytes done or PICO_ERROR_* */
+typedef struct {
+    int (*write)(uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+    int (*read)(uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+} host_i2c_bus_t;
+
+/* NULL detaches, then nobody answers */
+void host_i2c_attach(const host_i2c_bus_t *bus);
+
+/* Input level of a pin, pull-ups make unset ones read high */
+void host_gpio_set(unsigned gpio, bool level);
+/* What the firmware drives an output to */
+bool host_gpio_level(unsigned gpio);
+
+/* adc_read() returns source(selected input), 0 without one */
+void host_adc_source(uint16_t (*source)(unsigned input));
+
+/* Flash ops take their typical time on a W25Q16JV off the clock */
+#define HOST_FLASH_ERASE_US 45000 // a sector
+#define HOST_FLASH_PROGRAM_US 400 // a page
+
+/* Flash image, any buffer of PICO_FLASH_SIZE_BYTES, all 0xff at start */
+void host_flash_use(uint8_t *image);
+
+/* The flash op after the next n ops is cut half way: half a page gets
+   programmed or half a sector erased, then power_cut() is called and is
+   expected not to return. n < 0 disarms it. */
+void host_flash_cut(int n, void (*power_cut)());
+
+typedef struct {
+    uint32_t erases;
+    uint32_t programs;
+} host_flash_stat_t;
+
+void host_flash_stat(host_flash_stat_t *stat);
+
+#endif
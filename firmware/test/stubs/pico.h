@@ -0,0 +1,41 @@
+/*
+ * Host build stand-in for the Pico SDK base header
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef PICO_H
+#define PICO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+typedef unsigned int uint;
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+#define __isr
+#define __not_in_flash_func(func) func
+#define __time_critical_func(func) func
+#define __force_inline inline __attribute__((always_inline))
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC -1
+#define PICO_ERROR_TIMEOUT -2
+
+static inline void tight_loop_contents()
+{
+}
+
+static inline void __dmb()
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __compiler_memory_barrier()
+{
+    __asm__ volatile ("" ::: "memory");
+}
+
+#endif
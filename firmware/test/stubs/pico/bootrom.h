@@ -0,0 +1,13 @@
+/*
+ * Host build stand-in for pico/bootrom.h
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef _PICO_BOOTROM_H
+#define _PICO_BOOTROM_H
+
+#include "pico.h"
+
+void reset_usb_boot(uint32_t usb_activity_gpio_pin_mask, uint32_t disable_interface_mask);
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * Host build stand-in for pico/multicore.h
+ * WHowe <github.com/whowechina>
+ *
+ * Single threaded, a mutex is just a flag.
+ */
+
+#ifndef _PICO_MULTICORE_H
+#define _PICO_MULTICORE_H
+
+#include "pico.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+typedef struct {
+    bool owned;
+} mutex_t;
+
+void mutex_init(mutex_t *mtx);
+bool mutex_try_enter(mutex_t *mtx, uint32_t *owner_out);
+bool mutex_enter_timeout_us(mutex_t *mtx, uint32_t timeout_us);
+void mutex_exit(mutex_t *mtx);
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * Host build stand-in for pico/stdio.h
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef _PICO_STDIO_H
+#define _PICO_STDIO_H
+
+#include <stdio.h>
+
+#include "pico.h"
+
+#endif
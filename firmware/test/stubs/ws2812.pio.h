@@ -0,0 +1,15 @@
+/*
+ * Host build stand-in for the header generated from ws2812.pio
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef WS2812_PIO_H
+#define WS2812_PIO_H
+
+#include "hardware/pio.h"
+
+extern const pio_program_t ws2812_program;
+
+void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw);
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * Minimal Host Test Checks
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+extern int test_failures;
+
+/* Keeps going after a failure, main() returns test_result() */
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        long long _a = (a), _b = (b); \
+        if (_a != _b) { \
+            printf("%s:%d: check failed: %s == %s (%lld vs %lld)\n", \
+                   __FILE__, __LINE__, #a, #b, _a, _b); \
+            test_failures++; \
+        } \
+    } while (0)
+
+/* xorshift32, deterministic so a failure can be reproduced */
+static uint32_t test_rand_state = 1;
+
+static inline void test_seed(uint32_t seed)
+{
+    test_rand_state = seed ? seed : 1;
+}
+
+static inline uint32_t test_rand()
+{
+    uint32_t x = test_rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    test_rand_state = x;
+    return x;
+}
+
+static inline int test_result(const char *name)
+{
+    if (test_failures) {
+        printf("%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+#endif
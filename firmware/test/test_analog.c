@@ -0,0 +1,274 @@
+/*
+ * Analog touch engine tests, driven by sensor traces
+ * WHowe <github.com/whowechina>
+ *
+ * Without arguments it runs scripted synthetic traces with a known ground
+ * truth. Capture files given as arguments are replayed and summarized.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+#include "analog.h"
+#include "trace_file.h"
+#include "trace_synth.h"
+
+#define FRAME_MAX 4000
+#define QUARTER_KEY (254 / ANALOG_KEY_NUM / 4)
+
+static trace_frame_t frames[FRAME_MAX];
+static uint8_t baseline[TRACE_PAD_NUM];
+
+int test_failures;
+
+/* contact position the engine should give for a finger at pos */
+static int expected_contact(int pos)
+{
+    return 1 + (pos / 2) * 254 / (ANALOG_KEY_NUM * 256);
+}
+
+/* frames are packed, the engine wants aligned data */
+static uint32_t process_frame(const trace_frame_t *frame)
+{
+    uint16_t filtered[TRACE_PAD_NUM];
+    memcpy(filtered, frame->filtered, sizeof(filtered));
+    return analog_process(filtered, baseline);
+}
+
+static uint32_t process(int f)
+{
+    return process_frame(&frames[f]);
+}
+
+static void test_idle()
+{
+    synth_script_t script = { .seed = 1, .noise = 3,
+                              .spike = 12, .spike_rate = 40 };
+    synth_trace(&script, frames, FRAME_MAX, baseline);
+    analog_init();
+    int false_touch = 0;
+    for (int f = 0; f < FRAME_MAX; f++) {
+        false_touch += process(f) != 0;
+    }
+    CHECK_EQ(false_touch, 0);
+}
+
+static void test_drift()
+{
+    synth_script_t script = { .seed = 2, .noise = 3, .drift = -15 };
+    synth_trace(&script, frames, FRAME_MAX, baseline);
+    analog_init();
+    int false_touch = 0;
+    for (int f = 0; f < FRAME_MAX; f++) {
+        false_touch += process(f) != 0;
+    }
+    CHECK_EQ(false_touch, 0);
+}
+
+/* touch and release show up in the same frame, and only on that pad */
+static void test_tap()
+{
+    synth_script_t script = { .seed = 3, .noise = 3, .finger_num = 1,
+        .finger = { { 100, 200, SYNTH_PAD(10), SYNTH_PAD(10), 60 } } };
+    synth_trace(&script, frames, 400, baseline);
+    analog_init();
+    for (int f = 0; f < 400; f++) {
+        uint32_t touched = process(f);
+        uint32_t expect = ((f >= 100) && (f < 200)) ? 1 << 10 : 0;
+        if (touched != expect) {
+            printf("tap frame %d: %08x\n", f, touched);
+            test_failures++;
+            break;
+        }
+    }
+}
+
+/* a finger hovering right at the touch threshold must not chatter */
+static void test_hysteresis()
+{
+    synth_script_t script = { .seed = 4, .noise = 4, .finger_num = 1,
+        .finger = { { 200, 1800, SYNTH_PAD(5), SYNTH_PAD(5), 24 } } };
+    synth_trace(&script, frames, 2000, baseline);
+    analog_init();
+    int presses = 0;
+    int releases = 0;
+    bool on = false;
+    for (int f = 0; f < 2000; f++) {
+        bool now = process(f) & (1 << 5);
+        presses += now && !on;
+        releases += !now && on;
+        on = now;
+    }
+    CHECK_EQ(presses, 1);
+    CHECK_EQ(releases, 1);
+    CHECK(!on);
+}
+
+/* thresholds climb on a noisy pad, a real finger still gets through */
+static void test_noisy()
+{
+    const int warmup = 300;
+    synth_script_t script = { .seed = 5, .noise = 30, .finger_num = 1,
+        .finger = { { 3000, 3500, SYNTH_PAD(20), SYNTH_PAD(20), 150 } } };
+    synth_trace(&script, frames, FRAME_MAX, baseline);
+    analog_init();
+    int false_touch = 0;
+    int hits = 0;
+    for (int f = 0; f < FRAME_MAX; f++) {
+        uint32_t touched = process(f);
+        if (f < warmup) {
+            continue;
+        }
+        if ((f >= 3000) && (f < 3500)) {
+            hits += (touched & (1 << 20)) != 0;
+        } else {
+            false_touch += touched != 0;
+        }
+    }
+    CHECK_EQ(false_touch, 0);
+    CHECK(hits > 490);
+}
+
+/* contact follows a finger sliding along the whole slider */
+static void test_slide()
+{
+    const int len = 3200;
+    synth_script_t script = { .seed = 6, .noise = 2, .finger_num = 1,
+        .finger = { { 0, len, SYNTH_PAD(0), SYNTH_PAD(31), 60 } } };
+    synth_trace(&script, frames, len, baseline);
+    analog_init();
+    int max_err = 0;
+    int lost = 0;
+    int backwards = 0;
+    int last = 0;
+    for (int f = 0; f < len; f++) {
+        process(f);
+        uint8_t pos[ANALOG_MAX_CONTACTS];
+        if (analog_contacts(pos) != 1) {
+            lost++;
+            continue;
+        }
+        int truth = expected_contact(synth_finger_pos(&script.finger[0], f));
+        int err = abs(pos[0] - truth);
+        max_err = err > max_err ? err : max_err;
+        backwards += pos[0] + QUARTER_KEY < last; // jitter as runs grow is fine
+        last = pos[0];
+    }
+    printf("slide: max error %d of 255, %d lost, %d backwards\n",
+           max_err, lost, backwards);
+    CHECK_EQ(lost, 0);
+    CHECK_EQ(backwards, 0);
+    CHECK(max_err <= 8); // half a key
+}
+
+static void test_two_fingers()
+{
+    synth_script_t script = { .seed = 7, .noise = 3, .finger_num = 2,
+        .finger = { { 10, 100, SYNTH_PAD(6), SYNTH_PAD(6), 70 },
+                    { 10, 100, SYNTH_PAD(25), SYNTH_PAD(25), 70 } } };
+    synth_trace(&script, frames, 100, baseline);
+    analog_init();
+    for (int f = 0; f < 100; f++) {
+        process(f);
+    }
+    uint8_t pos[ANALOG_MAX_CONTACTS];
+    CHECK_EQ(analog_contacts(pos), 2);
+    CHECK(abs(pos[0] - expected_contact(SYNTH_PAD(6))) <= 8);
+    CHECK(abs(pos[1] - expected_contact(SYNTH_PAD(25))) <= 8);
+}
+
+/* capture files come with CLI echo mixed in */
+static void test_file()
+{
+    synth_script_t script = { .seed = 8, .noise = 3, .finger_num = 1,
+        .finger = { { 5, 40, SYNTH_PAD(3), SYNTH_PAD(12), 50 } } };
+    synth_trace(&script, frames, 50, baseline);
+
+    static uint8_t raw[sizeof(frames)];
+    size_t len = 0;
+    for (int f = 0; f < 50; f++) {
+        if (f % 7 == 3) {
+            const char *echo = "\r\nchu_pico>";
+            memcpy(raw + len, echo, strlen(echo));
+            len += strlen(echo);
+        }
+        memcpy(raw + len, &frames[f], sizeof(frames[f]));
+        if (f == 20) {
+            raw[len + 10] ^= 0xff; // corrupted one is dropped
+        }
+        len += sizeof(frames[f]);
+    }
+
+    char path[] = "/tmp/chu_traceXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    CHECK_EQ(write(fd, raw, len), len);
+    close(fd);
+
+    trace_frame_t *loaded;
+    int num = trace_load(path, &loaded);
+    unlink(path);
+    CHECK_EQ(num, 49);
+    for (int f = 0, src = 0; f < num; f++, src++) {
+        src += src == 20;
+        CHECK(memcmp(&loaded[f], &frames[src], sizeof(frames[src])) == 0);
+    }
+    free(loaded);
+}
+
+static int replay(const char *path)
+{
+    trace_frame_t *trace;
+    int num = trace_load(path, &trace);
+    if (num < 0) {
+        printf("%s: can't read\n", path);
+        return 1;
+    }
+    trace_baseline(trace, num, baseline);
+    analog_init();
+
+    int presses = 0;
+    int agree = 0;
+    int max_contacts = 0;
+    uint32_t last = 0;
+    for (int f = 0; f < num; f++) {
+        uint32_t touched = process_frame(&trace[f]);
+        uint32_t chip = trace[f].touched[0] | (trace[f].touched[1] << 12) |
+                        ((uint32_t)trace[f].touched[2] << 24);
+        presses += __builtin_popcount(touched & ~last);
+        agree += touched == chip;
+        last = touched;
+        uint8_t pos[ANALOG_MAX_CONTACTS];
+        int n = analog_contacts(pos);
+        max_contacts = n > max_contacts ? n : max_contacts;
+    }
+    printf("%s: %d frames, %d pad presses, %d max contacts, "
+           "%d%% frames agree with MPR121\n", path, num, presses,
+           max_contacts, num ? agree * 100 / num : 0);
+    free(trace);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        int fail = 0;
+        for (int i = 1; i < argc; i++) {
+            fail |= replay(argv[i]);
+        }
+        return fail;
+    }
+
+    test_idle();
+    test_drift();
+    test_tap();
+    test_hysteresis();
+    test_noisy();
+    test_slide();
+    test_two_fingers();
+    test_file();
+    return test_result("analog");
+}
@@ -0,0 +1,143 @@
+/*
+ * MPR121 health monitor test
+ * WHowe <github.com/whowechina>
+ *
+ * slider.c on the simulated cabinet with one chip going bad: a wrong ECR
+ * readback or new out-of-range bits. The chip has to be re-initialized
+ * alone, config included, with a backoff doubling from 1s up to 32s,
+ * and a chip that comes back healthy starts over from 1s.
+ */
+
+#include <string.h>
+
+#include "test.h"
+#include "host.h"
+#include "host_boot.h"
+#include "cabinet.h"
+
+#include "board_defs.h"
+#include "config.h"
+#include "slider.h"
+#include "i2c_scan.h"
+
+#define SCAN_MARGIN_US 100 // same as main.c
+#define FRAME_US 1000
+#define RETRY_MIN_US 1000000   // HEALTH_RETRY_MIN_US in slider.c
+#define RETRY_MAX_US 32000000  // HEALTH_RETRY_MAX_US
+#define DETECT_US 700000       // 2 bad checks, one chip every 100ms
+#define SLACK_US 5000          // re-init is checked for once a frame
+#define TOUCH_THRESHOLD_REG 0x41
+#define SENSE 3
+
+int test_failures;
+
+static trace_frame_t frame;
+static uint8_t baseline[TRACE_PAD_NUM];
+static uint64_t now_us;
+
+/* the sensing part of core0_loop() in main.c */
+static void run_frame()
+{
+    now_us += FRAME_US;
+    if (time_us_64() < now_us) {
+        host_time_set(now_us);
+    }
+    cabinet_show(&frame, baseline);
+    slider_scan();
+    uint32_t scan_us = i2c_scan_bus_us(I2C_FREQ) + SCAN_MARGIN_US;
+    i2c_scan_start();
+    i2c_scan_sync(scan_us);
+    slider_update();
+}
+
+/* time of the next re-init of chip, 0 if none within limit_us */
+static uint64_t next_reinit(unsigned chip, uint64_t limit_us)
+{
+    unsigned resets = cabinet_resets(chip);
+    uint64_t end = now_us + limit_us;
+    while (now_us < end) {
+        run_frame();
+        if (cabinet_resets(chip) != resets) {
+            return now_us;
+        }
+    }
+    return 0;
+}
+
+/* cabinet power cycle and slider_init(), the clock goes on */
+static void boot()
+{
+    host_boot();
+    host_time_step(0);
+    now_us = time_us_64(); // slider.c keeps its check schedule
+    chu_cfg->sense.global = SENSE;
+    cabinet_init();
+    cabinet_show(&frame, baseline);
+    slider_init();
+}
+
+/* config that only slider_update_config() writes, the reset clears it */
+static bool configured(unsigned chip)
+{
+    return cabinet_reg(chip, TOUCH_THRESHOLD_REG) ==
+           mpr121_touch_threshold(SENSE + chu_cfg->sense.keys[chip * 12]);
+}
+
+static void test_backoff(unsigned chip, int ecr, uint16_t oor)
+{
+    boot();
+    CHECK_EQ(cabinet_resets(chip), 1);
+    CHECK(configured(chip));
+    CHECK_EQ(next_reinit(chip, 2000000), 0); // healthy, left alone
+
+    cabinet_fault(chip, ecr, oor);
+    uint64_t last = next_reinit(chip, DETECT_US);
+    CHECK(last > 0);
+    CHECK(configured(chip));
+    for (int c = 0; c < 3; c++) {
+        CHECK_EQ(cabinet_resets(c), c == chip ? 2 : 1);
+    }
+
+    uint32_t expect = RETRY_MIN_US;
+    for (int i = 0; i < 7; i++) { // 1, 2, 4, 8, 16, 32 and 32s
+        uint64_t at = next_reinit(chip, expect + DETECT_US);
+        CHECK(at >= last + expect);
+        CHECK(at < last + expect + SLACK_US);
+        CHECK(configured(chip));
+        last = at;
+        expect = expect * 2 < RETRY_MAX_US ? expect * 2 : RETRY_MAX_US;
+    }
+
+    /* a chip that comes back needs no re-init, checks bring it back */
+    cabinet_fault(chip, -1, 0);
+    CHECK_EQ(next_reinit(chip, RETRY_MAX_US + DETECT_US), 0);
+    CHECK(strstr(slider_sensor_status(), "ERR") == NULL);
+
+    /* then it goes bad again and the backoff starts over */
+    cabinet_fault(chip, ecr, oor);
+    last = next_reinit(chip, DETECT_US);
+    CHECK(last > 0);
+    uint64_t at = next_reinit(chip, RETRY_MIN_US + DETECT_US);
+    CHECK(at >= last + RETRY_MIN_US);
+    CHECK(at < last + RETRY_MIN_US + SLACK_US);
+}
+
+/* New out-of-range bits get the chip re-initialized, if they stay after
+   that they're learned as normal for this chip */
+static void test_oor(unsigned chip, uint16_t oor)
+{
+    boot();
+    CHECK_EQ(next_reinit(chip, 2000000), 0); // normal OOR bits learned
+    cabinet_fault(chip, -1, oor);
+    CHECK(next_reinit(chip, DETECT_US) > 0);
+    CHECK(configured(chip));
+    CHECK_EQ(next_reinit(chip, RETRY_MIN_US * 4), 0);
+}
+
+int main()
+{
+    test_backoff(0, 0, 0);     // ECR reads back 0, chip stopped
+    test_backoff(2, 0, 0x05);  // stopped, electrodes 0 and 2 out of range
+    test_oor(1, 0x0f00);
+    return test_result("health");
+}
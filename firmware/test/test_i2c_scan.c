@@ -0,0 +1,365 @@
+/*
+ * I2C scan engine queue test over a mock backend
+ * WHowe <github.com/whowechina>
+ *
+ * The mock bus takes BUS_TXN_US per transaction and "interrupts" when
+ * IRQs get enabled again after that, like the I2C IRQ would. Devices
+ * can answer, NACK or hang the bus.
+ */
+
+#include <string.h>
+
+#include "test.h"
+#include "host.h"
+#include "i2c_scan.h"
+
+#define BUS_TXN_US 50
+#define QUEUE_SIZE 32
+#define LOG_SIZE 64
+
+enum { DEV_OK, DEV_NACK, DEV_HANG };
+
+static struct {
+    const i2c_txn_t *current;
+    uint64_t since;
+    bool irq_on;
+    bool in_done;
+    uint8_t device[128];
+    unsigned aborts;
+    unsigned starts;
+    unsigned inits;
+    bool init_irq_on;
+    bool done_while_masked;
+} bus;
+
+/* what the bus saw, and what callbacks reported, in order */
+static uint32_t bus_log[LOG_SIZE];
+static unsigned bus_log_num;
+static uint32_t cb_log[LOG_SIZE];
+static bool cb_ok[LOG_SIZE];
+static unsigned cb_log_num;
+
+int test_failures;
+
+static void mock_start(const i2c_txn_t *txn)
+{
+    bus.current = txn;
+    bus.since = time_us_64();
+    bus.starts++;
+    if (bus_log_num < LOG_SIZE) {
+        bus_log[bus_log_num++] = txn->arg;
+    }
+}
+
+static void mock_abort()
+{
+    bus.current = NULL;
+    bus.aborts++;
+}
+
+/* a pending "interrupt" is taken when IRQs come back on */
+static void mock_irq_enable(bool on)
+{
+    bus.irq_on = on;
+    while (on && bus.current && !bus.in_done) {
+        const i2c_txn_t *txn = bus.current;
+        uint8_t dev = bus.device[txn->addr & 0x7f];
+        if ((dev == DEV_HANG) || (time_us_64() - bus.since < BUS_TXN_US)) {
+            return;
+        }
+        for (int i = 0; i < txn->rlen; i++) {
+            txn->rbuf[i] = txn->addr + txn->wbuf[0] + i;
+        }
+        bus.current = NULL;
+        bus.in_done = true; // done may start the next one, no nesting
+        i2c_scan_done(dev == DEV_OK);
+        bus.in_done = false;
+    }
+}
+
+static void mock_bus_init(uint32_t baudrate)
+{
+    bus.inits++;
+    bus.init_irq_on |= bus.irq_on;
+}
+
+static const i2c_scan_backend_t mock = {
+    .start = mock_start,
+    .abort = mock_abort,
+    .irq_enable = mock_irq_enable,
+    .bus_init = mock_bus_init,
+};
+
+static void reset()
+{
+    memset(&bus, 0, sizeof(bus));
+    bus_log_num = 0;
+    cb_log_num = 0;
+    i2c_scan_use(&mock);
+    host_time_step(10);
+}
+
+static void logged(const i2c_txn_t *txn, bool ok)
+{
+    if (bus.irq_on && !bus.in_done) {
+        bus.done_while_masked = true;
+    }
+    if (cb_log_num < LOG_SIZE) {
+        cb_ok[cb_log_num] = ok;
+        cb_log[cb_log_num++] = txn->arg;
+    }
+}
+
+static i2c_txn_t txn_of(uint8_t addr, uint32_t id)
+{
+    static uint8_t rbuf[2];
+    i2c_txn_t txn = { .addr = addr, .wlen = 1, .wbuf = { 0x10 },
+                      .rlen = 2, .rbuf = rbuf, .cb = logged, .arg = id };
+    return txn;
+}
+
+static void chaining(const i2c_txn_t *txn, bool ok)
+{
+    logged(txn, ok);
+    i2c_txn_t a = txn_of(0x20, txn->arg * 10 + 1);
+    i2c_txn_t b = txn_of(0x20, txn->arg * 10 + 2);
+    if (txn->arg == 1) {
+        b.cb = chaining; // chains 21 and 22 right after itself
+    }
+    i2c_scan_chain(&a);
+    i2c_scan_chain(&b);
+}
+
+static void test_order()
+{
+    reset();
+    for (int i = 1; i <= 3; i++) {
+        i2c_txn_t txn = txn_of(0x10, i);
+        CHECK(i2c_scan_add(&txn));
+    }
+    i2c_scan_start();
+    CHECK(i2c_scan_busy());
+
+    i2c_txn_t late = txn_of(0x10, 9);
+    CHECK(!i2c_scan_add(&late)); // no adding while it runs
+
+    CHECK(i2c_scan_sync(10000));
+    CHECK(!i2c_scan_busy());
+    CHECK_EQ(bus_log_num, 3);
+    CHECK_EQ(cb_log_num, 3);
+    for (int i = 0; i < 3; i++) {
+        CHECK_EQ(bus_log[i], i + 1);
+        CHECK_EQ(cb_log[i], i + 1);
+        CHECK(cb_ok[i]);
+    }
+    CHECK(!bus.done_while_masked);
+}
+
+static void test_read_data()
+{
+    reset();
+    uint8_t buf[4] = { 0 };
+    CHECK(i2c_scan_read(0x5a, 0x04, buf, 4, logged, 1));
+    i2c_scan_start();
+    CHECK(i2c_scan_sync(10000));
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQ(buf[i], 0x5a + 0x04 + i);
+    }
+}
+
+/* chained ones run right after their parent, in chain order,
+   before anything queued earlier */
+static void test_chain()
+{
+    reset();
+    i2c_txn_t first = txn_of(0x10, 1);
+    first.cb = chaining;
+    i2c_txn_t second = txn_of(0x10, 2);
+    CHECK(i2c_scan_add(&first));
+    CHECK(i2c_scan_add(&second));
+    i2c_scan_start();
+    CHECK(i2c_scan_sync(10000));
+
+    const uint32_t expect[] = { 1, 11, 12, 121, 122, 2 };
+    CHECK_EQ(bus_log_num, count_of(expect));
+    for (int i = 0; i < count_of(expect); i++) {
+        CHECK_EQ(bus_log[i], expect[i]);
+    }
+}
+
+/* outside a callback nothing gets in while it runs, the queue stays as is */
+static void test_chain_outside()
+{
+    reset();
+    for (int i = 1; i <= 3; i++) {
+        i2c_txn_t txn = txn_of(0x10, i);
+        CHECK(i2c_scan_add(&txn));
+    }
+    i2c_txn_t early = txn_of(0x10, 9);
+    CHECK(!i2c_scan_chain(&early)); // not even before the start
+
+    i2c_scan_start();
+    i2c_txn_t late = txn_of(0x10, 8);
+    CHECK(!i2c_scan_chain(&late));
+    uint8_t buf[2];
+    CHECK(!i2c_scan_read(0x10, 0, buf, 2, logged, 7));
+    CHECK(!i2c_scan_write(0x10, buf, 1, logged, 6));
+
+    CHECK(i2c_scan_sync(10000));
+    CHECK_EQ(bus_log_num, 3);
+    for (int i = 0; i < 3; i++) {
+        CHECK_EQ(bus_log[i], i + 1);
+    }
+}
+
+static void test_full()
+{
+    reset();
+    int added = 0;
+    for (int i = 0; i < QUEUE_SIZE + 4; i++) {
+        i2c_txn_t txn = txn_of(0x10, i);
+        added += i2c_scan_add(&txn);
+    }
+    CHECK_EQ(added, QUEUE_SIZE - 1);
+    i2c_scan_start();
+    CHECK(i2c_scan_sync(100000));
+    CHECK_EQ(cb_log_num, QUEUE_SIZE - 1);
+}
+
+/* a NACK fails that one only */
+static void test_nack()
+{
+    reset();
+    bus.device[0x11] = DEV_NACK;
+    for (int i = 0; i < 3; i++) {
+        i2c_txn_t txn = txn_of(0x10 + i, i);
+        i2c_scan_add(&txn);
+    }
+    i2c_scan_start();
+    CHECK(i2c_scan_sync(10000));
+    CHECK_EQ(cb_log_num, 3);
+    CHECK(cb_ok[0] && !cb_ok[1] && cb_ok[2]);
+}
+
+/* a hung device costs one transaction timeout, the rest still run */
+static void test_txn_timeout()
+{
+    reset();
+    uint32_t aborted0, dropped0, aborted, dropped;
+    i2c_scan_stat(&aborted0, &dropped0);
+
+    bus.device[0x11] = DEV_HANG;
+    for (int i = 0; i < 3; i++) {
+        i2c_txn_t txn = txn_of(0x10 + i, i);
+        i2c_scan_add(&txn);
+    }
+    uint64_t start = time_us_64();
+    i2c_scan_start();
+    CHECK(i2c_scan_sync(10000));
+    uint64_t spent = time_us_64() - start;
+
+    CHECK_EQ(cb_log_num, 3);
+    CHECK(cb_ok[0] && !cb_ok[1] && cb_ok[2]);
+    CHECK_EQ(bus.aborts, 1);
+    CHECK(spent >= 1000);
+    CHECK(spent < 2000);
+
+    i2c_scan_stat(&aborted, &dropped);
+    CHECK_EQ(aborted - aborted0, 1);
+    CHECK_EQ(dropped - dropped0, 0);
+}
+
+/* nobody syncs: the next start takes care of a stuck transaction */
+static void test_start_timeout()
+{
+    reset();
+    bus.device[0x10] = DEV_HANG;
+    for (int i = 0; i < 2; i++) {
+        i2c_txn_t txn = txn_of(0x10 + i, i);
+        i2c_scan_add(&txn);
+    }
+    i2c_scan_start();
+    host_time_advance(500);
+    i2c_scan_start(); // not yet
+    CHECK_EQ(bus.aborts, 0);
+    CHECK(i2c_scan_busy());
+
+    host_time_advance(600);
+    i2c_scan_start();
+    CHECK_EQ(bus.aborts, 1);
+    CHECK_EQ(bus.starts, 2); // and the next one went on
+    CHECK(i2c_scan_sync(10000));
+    CHECK_EQ(cb_log_num, 2);
+    CHECK(!cb_ok[0] && cb_ok[1]);
+}
+
+/* a bus re-init in the middle of a scan: IRQ off, the queue given up */
+static void test_bus_init()
+{
+    reset();
+    for (int i = 0; i < 3; i++) {
+        i2c_txn_t txn = txn_of(0x10 + i, i);
+        i2c_scan_add(&txn);
+    }
+    i2c_scan_start();
+    i2c_scan_bus_init(400000);
+    CHECK_EQ(bus.inits, 1);
+    CHECK(!bus.init_irq_on);
+    CHECK(bus.irq_on);
+    CHECK(!i2c_scan_busy());
+    CHECK_EQ(bus.aborts, 1);
+    CHECK_EQ(cb_log_num, 0);
+
+    i2c_txn_t txn = txn_of(0x10, 7);
+    CHECK(i2c_scan_add(&txn));
+    i2c_scan_start();
+    CHECK(i2c_scan_sync(10000));
+    CHECK_EQ(cb_log_num, 1);
+}
+
+/* out of time: the running one is aborted, the rest dropped unstarted */
+static void test_sync_timeout()
+{
+    reset();
+    uint32_t aborted0, dropped0, aborted, dropped;
+    i2c_scan_stat(&aborted0, &dropped0);
+
+    bus.device[0x12] = DEV_HANG;
+    for (int i = 0; i < 6; i++) {
+        i2c_txn_t txn = txn_of(0x10 + i, i);
+        i2c_scan_add(&txn);
+    }
+    i2c_scan_start();
+    CHECK(!i2c_scan_sync(500));
+    CHECK(!i2c_scan_busy());
+
+    /* 0 and 1 done, 2 aborted, 3..5 never started */
+    CHECK_EQ(bus.starts, 3);
+    CHECK_EQ(cb_log_num, 2);
+    i2c_scan_stat(&aborted, &dropped);
+    CHECK_EQ(aborted - aborted0, 1);
+    CHECK_EQ(dropped - dropped0, 3);
+
+    /* and the engine still works afterwards */
+    bus.device[0x12] = DEV_OK;
+    i2c_txn_t txn = txn_of(0x12, 7);
+    CHECK(i2c_scan_add(&txn));
+    i2c_scan_start();
+    CHECK(i2c_scan_sync(10000));
+    CHECK_EQ(cb_log[cb_log_num - 1], 7);
+}
+
+int main()
+{
+    test_order();
+    test_read_data();
+    test_chain();
+    test_chain_outside();
+    test_full();
+    test_nack();
+    test_txn_timeout();
+    test_start_timeout();
+    test_bus_init();
+    test_sync_timeout();
+    return test_result("i2c_scan");
+}
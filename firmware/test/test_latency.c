@@ -0,0 +1,81 @@
+/*
+ * Input latency trace test
+ * WHowe <github.com/whowechina>
+ *
+ * A touch whose report never goes out (HID modes off, endpoint gone) must
+ * not keep latency.c busy, later touches still have to get traced.
+ */
+
+#include "test.h"
+#include "latency.h"
+
+int test_failures;
+
+static uint32_t traced()
+{
+    latency_stat_t stat;
+    latency_stat(LATENCY_STAGE_TOTAL, &stat);
+    return stat.count;
+}
+
+static void test_normal()
+{
+    latency_reset();
+    latency_begin(1000, 1200);
+    latency_mark(LATENCY_BUILT, 1300);
+    latency_end(1500);
+    CHECK_EQ(traced(), 1);
+
+    latency_stat_t stat;
+    latency_stat(LATENCY_STAGE_TOTAL, &stat);
+    CHECK_EQ(stat.max, 500);
+}
+
+/* report_usb_hid() with both HID modes off */
+static void test_cancel()
+{
+    latency_reset();
+    latency_begin(1000, 1200);
+    latency_cancel();
+    latency_end(1500);
+    CHECK_EQ(traced(), 0);
+
+    latency_begin(2000, 2100);
+    latency_end(2400);
+    CHECK_EQ(traced(), 1);
+    CHECK_EQ(latency_hist_count(4), 1);
+}
+
+/* no report and no cancel, a later touch takes over once it's expired */
+static void test_expire()
+{
+    latency_reset();
+    latency_begin(1000, 1200);
+    latency_begin(5000, 5100); // too soon, the first one is still on
+    latency_end(5300);
+    CHECK_EQ(traced(), 1);
+    CHECK_EQ(latency_hist_count(LATENCY_BUCKET_NUM - 1), 1);
+
+    latency_reset();
+    latency_begin(1000, 1200);
+    uint32_t later = 1200 + LATENCY_EXPIRE_US;
+    latency_begin(later - 100, later);
+    latency_end(later + 200);
+    CHECK_EQ(traced(), 1);
+    CHECK_EQ(latency_hist_count(3), 1);
+
+    /* time_us_32() wraps */
+    latency_reset();
+    latency_begin(0xfffff000, 0xfffff100);
+    latency_begin(0x100, 0x200);
+    latency_end(0x300);
+    CHECK_EQ(latency_hist_count(LATENCY_BUCKET_NUM - 1), 1);
+}
+
+int main()
+{
+    test_normal();
+    test_cancel();
+    test_expire();
+    return test_result("latency");
+}
@@ -0,0 +1,203 @@
+/*
+ * Host LED path equivalence test
+ * WHowe <github.com/whowechina>
+ *
+ * What reaches the DMA frames has to be word for word what the old path
+ * produced, for plain and lzfx host frames, with and without split LEDs.
+ * Delta reports from the host encoder have to end up the same as full
+ * frames, and it tells how much they save on the wire. Local writes
+ * still win over LEDs the host wrote before.
+ */
+
+#include <string.h>
+
+#include "test.h"
+#include "host.h"
+#include "host_boot.h"
+#include "config.h"
+#include "rgb.h"
+#include "lzfx_enc.h"
+#include "led_stream.h"
+#include "led_delta.h"
+#include "ref/led_ref.h"
+
+#define FRAME_NUM 500
+#define LED_FRAME_US 4000 // LED_HOST_FRAME_US in rgb.c
+#define DMA_MAIN 0        // rgb_init() claims the first two channels
+#define DMA_TOWER 1
+#define DELTA_MAX 4
+
+/* HID report bytes on the wire per frame, report ID included */
+#define FULL_FRAME_BYTES ((48 + 1) + (45 + 1) + (18 + 1))
+#define REPORT_BYTES (63 + 1)
+#define LZFX_MAX 62 // length byte and data in the feature report
+
+int test_failures;
+
+static void compare(const char *what, int frame)
+{
+    uint32_t ref_main[LED_REF_FRAME_MAIN];
+    uint32_t ref_tower[LED_REF_FRAME_TOWER];
+    led_ref_pull();
+    unsigned ref_len = led_ref_fill(ref_main, ref_tower);
+
+    rgb_pull_host();
+    host_time_advance(LED_FRAME_US);
+    rgb_update();
+
+    unsigned len, tower_len;
+    const uint32_t *main_words = host_dma_last(DMA_MAIN, &len);
+    const uint32_t *tower_words = host_dma_last(DMA_TOWER, &tower_len);
+    if ((len != ref_len) || (tower_len != LED_REF_FRAME_TOWER) ||
+        memcmp(main_words, ref_main, len * 4) ||
+        memcmp(tower_words, ref_tower, sizeof(ref_tower))) {
+        printf("%s: frame %d differs\n", what, frame);
+        test_failures++;
+    }
+}
+
+static void run(bool lzfx, bool skip_split)
+{
+    chu_cfg->tweak.skip_split_led = skip_split;
+    led_stream_init(15);
+    for (int f = 0; (f < FRAME_NUM) && !test_failures; f++) {
+        uint8_t brg[LED_STREAM_BYTES];
+        led_stream_next(brg);
+        if (lzfx) {
+            uint8_t packed[LED_STREAM_BYTES * 2];
+            unsigned len = sizeof(packed);
+            CHECK_EQ(lzfx_compress(brg, sizeof(brg), packed, &len), 0);
+            CHECK(rgb_set_brg_lzfx(packed, len));
+            CHECK(led_ref_set_brg_lzfx(packed, len));
+        } else {
+            rgb_set_brg(0, brg, 16);
+            rgb_set_brg(16, brg + 16 * 3, 15);
+            rgb_set_brg(31, brg + 31 * 3, 6);
+            led_ref_set_brg(0, brg, 16);
+            led_ref_set_brg(16, brg + 16 * 3, 15);
+            led_ref_set_brg(31, brg + 31 * 3, 6);
+        }
+        compare(lzfx ? "lzfx" : "brg", f);
+    }
+}
+
+/* Full frames go to the old path, deltas of the same to rgb.c */
+static void run_delta()
+{
+    chu_cfg->tweak.skip_split_led = false;
+    led_stream_init(17);
+
+    uint8_t prev[LED_STREAM_BYTES] = { 0 }; // the device starts all dark
+    uint64_t full_bytes = 0;
+    uint64_t lzfx_bytes = 0;
+    uint64_t delta_bytes = 0;
+    int max_reports = 0;
+
+    for (int f = 0; (f < FRAME_NUM * 4) && !test_failures; f++) {
+        uint8_t brg[LED_STREAM_BYTES];
+        led_stream_next(brg);
+
+        uint8_t reports[DELTA_MAX][LED_DELTA_REPORT_LEN];
+        int num = led_delta_encode(prev, brg, LED_STREAM_LEDS, reports, DELTA_MAX);
+        CHECK(num >= 0);
+        for (int i = 0; i < num; i++) {
+            CHECK(rgb_set_brg_delta(reports[i], LED_DELTA_REPORT_LEN));
+        }
+        memcpy(prev, brg, sizeof(prev));
+        max_reports = num > max_reports ? num : max_reports;
+
+        led_ref_set_brg(0, brg, 16);
+        led_ref_set_brg(16, brg + 16 * 3, 15);
+        led_ref_set_brg(31, brg + 31 * 3, 6);
+        compare("delta", f);
+
+        uint8_t packed[LED_STREAM_BYTES * 2];
+        unsigned len = sizeof(packed);
+        lzfx_compress(brg, sizeof(brg), packed, &len);
+        full_bytes += FULL_FRAME_BYTES;
+        lzfx_bytes += len <= LZFX_MAX ? REPORT_BYTES : FULL_FRAME_BYTES;
+        delta_bytes += num * REPORT_BYTES;
+    }
+
+    /* rgb.c takes a host frame every 4ms at most */
+    const int frames = FRAME_NUM * 4;
+    const int fps = 250;
+    printf("LED wire bytes per frame: full %.1f, lzfx %.1f, delta %.1f "
+           "(up to %d reports)\n", (double)full_bytes / frames,
+           (double)lzfx_bytes / frames, (double)delta_bytes / frames, max_reports);
+    printf("at %d frames/s delta saves %.0f bytes/s over full, %.0f over lzfx\n",
+           fps, (double)(full_bytes - delta_bytes) * fps / frames,
+           (double)((int64_t)lzfx_bytes - (int64_t)delta_bytes) * fps / frames);
+    CHECK(delta_bytes < full_bytes);
+}
+
+static uint32_t sent(unsigned index)
+{
+    rgb_pull_host();
+    host_time_advance(LED_FRAME_US);
+    rgb_update();
+    unsigned len;
+    return host_dma_last(DMA_MAIN, &len)[index];
+}
+
+/* host LEDs go out from the host frame until a local write takes them back */
+static void test_local_override()
+{
+    chu_cfg->tweak.skip_split_led = false;
+    uint8_t brg[LED_STREAM_BYTES];
+    memset(brg, 0x40, sizeof(brg));
+
+    const unsigned led = 34; // aime LED, main frame word 34 without split
+    uint32_t local = 0;
+    rgb_set_colors(&local, led, 1);
+    rgb_set_brg(0, brg, LED_STREAM_LEDS);
+    uint32_t host = sent(led);
+    CHECK(host != 0);
+
+    rgb_set_colors(&local, led, 1); // same as buf_main still has
+    CHECK_EQ(sent(led), 0);
+
+    rgb_set_brg(0, brg, 31); // keys and gaps only
+    CHECK_EQ(sent(led), 0);
+
+    rgb_set_brg(0, brg, LED_STREAM_LEDS);
+    CHECK_EQ(sent(led), host);
+}
+
+/* runs are split to fit, unchanged LEDs are left out */
+static void test_delta_encode()
+{
+    uint8_t prev[LED_STREAM_BYTES] = { 0 };
+    uint8_t next[LED_STREAM_BYTES] = { 0 };
+    uint8_t reports[DELTA_MAX][LED_DELTA_REPORT_LEN];
+
+    CHECK_EQ(led_delta_encode(prev, next, LED_STREAM_LEDS, reports, DELTA_MAX), 0);
+
+    next[5 * 3] = 1;
+    next[7 * 3 + 2] = 2;
+    CHECK_EQ(led_delta_encode(prev, next, LED_STREAM_LEDS, reports, DELTA_MAX), 1);
+    const uint8_t expect[] = { 5, 1, 1, 0, 0, 7, 1, 0, 0, 2, 0 };
+    CHECK(memcmp(reports[0], expect, sizeof(expect)) == 0);
+
+    memset(next, 0x11, sizeof(next));
+    CHECK_EQ(led_delta_encode(prev, next, LED_STREAM_LEDS, reports, DELTA_MAX), 2);
+    CHECK_EQ(reports[0][0], 0);
+    CHECK_EQ(reports[0][1], 20);
+    CHECK_EQ(reports[1][0], 20);
+    CHECK_EQ(reports[1][1], LED_STREAM_LEDS - 20);
+    CHECK_EQ(led_delta_encode(prev, next, LED_STREAM_LEDS, reports, 1), -1);
+}
+
+int main()
+{
+    host_boot();
+    led_ref_init();
+    run(false, false);
+    run(true, false);
+    run(false, true);
+    run(true, true);
+    test_local_override();
+    test_delta_encode();
+    run_delta();
+    return test_result("led");
+}
@@ -0,0 +1,137 @@
+/*
+ * Lighting effect engine test
+ * WHowe <github.com/whowechina>
+ *
+ * Every style has to draw all the LEDs it owns on every frame, whatever
+ * the input, so the per frame cost stays what bench_lights measures.
+ */
+
+#include <string.h>
+
+#include "test.h"
+#include "host.h"
+#include "host_boot.h"
+#include "config.h"
+#include "rgb.h"
+#include "lights.h"
+
+#define FRAME_NUM 300
+#define LED_NUM 47          // buf_main in rgb.c
+#define LED_FRAME_US 16000  // LED_IDLE_FRAME_US in rgb.c, no host frames here
+#define DMA_MAIN 0
+#define MAIN_WORDS (31 + 16 + 6)
+
+int test_failures;
+
+static uint32_t now_us;
+
+static unsigned owned(const lights_input_t *input)
+{
+    return 31 + input->tof_num;
+}
+
+/* LEDs not drawn keep the poison, which then shows in the DMA frame */
+static void draw(const lights_input_t *input, uint32_t poison,
+                 uint32_t words[MAIN_WORDS])
+{
+    uint32_t fill[LED_NUM];
+    for (int i = 0; i < LED_NUM; i++) {
+        fill[i] = poison;
+    }
+    rgb_set_colors(fill, 0, owned(input));
+
+    lights_update(now_us, input);
+    host_time_advance(LED_FRAME_US);
+    rgb_update();
+
+    unsigned len;
+    const uint32_t *dma = host_dma_last(DMA_MAIN, &len);
+    CHECK_EQ(len, MAIN_WORDS);
+    memcpy(words, dma, sizeof(uint32_t) * MAIN_WORDS);
+}
+
+static void random_input(lights_input_t *input)
+{
+    input->touched = test_rand() & test_rand();
+    input->tof_num = test_rand() % 7;
+    for (int i = 0; i < 6; i++) {
+        input->tof[i] = test_rand() % 9; // 7 and 8 are out of the palette
+    }
+}
+
+/*
+ * Same time and input twice is the same picture, the second call steps
+ * no time and starts no new ripple. Only a skipped LED tells the two
+ * poisons apart.
+ */
+static void test_all_drawn(unsigned key, unsigned gap, unsigned tof)
+{
+    chu_cfg->style.key = key;
+    chu_cfg->style.gap = gap;
+    chu_cfg->style.tof = tof;
+    lights_init();
+    test_seed(18 + key * 9 + gap * 3 + tof);
+
+    for (int f = 0; f < FRAME_NUM; f++) {
+        lights_input_t input;
+        random_input(&input);
+        now_us += (f % 50 == 49) ? 200000 : 1000; // a stall now and then
+
+        uint32_t first[MAIN_WORDS];
+        uint32_t second[MAIN_WORDS];
+        draw(&input, 0x123456, first);
+        draw(&input, 0x654321, second);
+        if (memcmp(first, second, sizeof(first))) {
+            printf("style %u/%u/%u: frame %d leaves LEDs undrawn\n",
+                   key, gap, tof, f);
+            test_failures++;
+            return;
+        }
+    }
+}
+
+/* a released key fades back to key_off within FADE_MS (300ms) */
+static void test_fade_ends()
+{
+    chu_cfg->style.key = 1;
+    chu_cfg->style.gap = 0;
+    chu_cfg->style.tof = 0;
+    lights_init();
+
+    lights_input_t input = { 0 };
+    uint32_t off[MAIN_WORDS];
+    uint32_t words[MAIN_WORDS];
+    draw(&input, 0, off);
+
+    input.touched = 3; // key 0, frame word 30 - key_led(0)
+    now_us += 1000;
+    draw(&input, 0, words);
+    CHECK(words[0] != off[0]);
+
+    input.touched = 0;
+    for (int ms = 0; ms < 290; ms += 10) {
+        now_us += 10000;
+        draw(&input, 0, words);
+    }
+    CHECK(words[0] != off[0]);
+
+    now_us += 20000;
+    draw(&input, 0, words);
+    CHECK_EQ(words[0], off[0]);
+}
+
+int main()
+{
+    host_boot();
+
+    for (unsigned key = 0; key < LIGHTS_KEY_STYLE_NUM; key++) {
+        for (unsigned gap = 0; gap < LIGHTS_GAP_STYLE_NUM; gap++) {
+            for (unsigned tof = 0; tof < LIGHTS_TOF_STYLE_NUM; tof++) {
+                test_all_drawn(key, gap, tof);
+            }
+        }
+    }
+    test_fade_ends();
+
+    return test_result("lights");
+}
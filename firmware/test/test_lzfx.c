@@ -0,0 +1,186 @@
+/*
+ * Lzfx decoder equivalence test
+ * WHowe <github.com/whowechina>
+ *
+ * The fast decoder has to match the old byte by byte one exactly:
+ * return code, output length and every output byte, on valid streams,
+ * on damaged ones and on plain garbage, with any output buffer size.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "test.h"
+#include "lzfx.h"
+#include "lzfx_enc.h"
+#include "led_stream.h"
+#include "ref/lzfx_ref.h"
+
+#define FUZZ_ROUNDS 200000
+#define MAX_IN 320
+#define MAX_OUT 600
+#define SLACK 4 // the old decoder may read a byte past the input
+
+int test_failures;
+
+/* Runs both decoders on the same input and output size, compares all */
+static void compare(const uint8_t *in, unsigned ilen, unsigned osize)
+{
+    static uint8_t buf[MAX_IN + SLACK];
+    static uint8_t out_new[MAX_OUT + 16];
+    static uint8_t out_ref[MAX_OUT + 16];
+
+    memset(buf, 0x5a, sizeof(buf));
+    memcpy(buf, in, ilen);
+    memset(out_new, 0xcc, sizeof(out_new));
+    memset(out_ref, 0xcc, sizeof(out_ref));
+
+    unsigned olen_new = osize;
+    unsigned olen_ref = osize;
+    int rc_new = lzfx_decompress(buf, ilen, out_new, &olen_new);
+    int rc_ref = lzfx_decompress_ref(buf, ilen, out_ref, &olen_ref);
+
+    CHECK_EQ(rc_new, rc_ref);
+    CHECK_EQ(olen_new, olen_ref);
+    CHECK(memcmp(out_new, out_ref, sizeof(out_new)) == 0);
+}
+
+/* something compressible: runs, short patterns, copies and noise */
+static unsigned make_data(uint8_t *data, unsigned max)
+{
+    unsigned len = 1 + test_rand() % max;
+    unsigned pos = 0;
+    while (pos < len) {
+        unsigned n = 1 + test_rand() % 40;
+        if (n > len - pos) {
+            n = len - pos;
+        }
+        switch (test_rand() % 4) {
+            case 0:
+                memset(data + pos, test_rand(), n);
+                break;
+            case 1: {
+                unsigned period = 2 + test_rand() % 3;
+                for (unsigned i = 0; i < n; i++) {
+                    data[pos + i] = (i % period) * 17;
+                }
+                break;
+            }
+            case 2:
+                if (pos > 0) {
+                    unsigned from = test_rand() % pos;
+                    for (unsigned i = 0; i < n; i++) {
+                        data[pos + i] = data[from + i];
+                    }
+                    break;
+                }
+                /* fall through */
+            default:
+                for (unsigned i = 0; i < n; i++) {
+                    data[pos + i] = test_rand();
+                }
+                break;
+        }
+        pos += n;
+    }
+    return len;
+}
+
+static void test_round_trip()
+{
+    for (int round = 0; round < 20000; round++) {
+        uint8_t data[MAX_OUT];
+        uint8_t packed[MAX_OUT * 2];
+        uint8_t out[MAX_OUT];
+        unsigned len = make_data(data, sizeof(data));
+        unsigned plen = sizeof(packed);
+        CHECK_EQ(lzfx_compress(data, len, packed, &plen), 0);
+
+        unsigned olen = sizeof(out);
+        CHECK_EQ(lzfx_decompress(packed, plen, out, &olen), 0);
+        CHECK_EQ(olen, len);
+        CHECK(memcmp(out, data, len) == 0);
+    }
+}
+
+static void test_led_frames()
+{
+    led_stream_init(1);
+    unsigned raw = 0;
+    unsigned packed_total = 0;
+    for (int f = 0; f < 5000; f++) {
+        uint8_t brg[LED_STREAM_BYTES];
+        uint8_t packed[LED_STREAM_BYTES * 2];
+        unsigned plen = sizeof(packed);
+        led_stream_next(brg);
+        CHECK_EQ(lzfx_compress(brg, sizeof(brg), packed, &plen), 0);
+        raw += sizeof(brg);
+        packed_total += plen;
+
+        compare(packed, plen, (48 + 45 + 6) * 3);
+        compare(packed, plen, sizeof(brg));
+        compare(packed, plen, sizeof(brg) - 1 - f % 40);
+    }
+    printf("led frames: %u bytes packed into %u\n", raw, packed_total);
+}
+
+static void test_fuzz()
+{
+    for (int round = 0; round < FUZZ_ROUNDS; round++) {
+        uint8_t in[MAX_IN];
+        unsigned ilen;
+
+        if (round % 3 == 0) {
+            /* plain garbage */
+            ilen = 1 + test_rand() % MAX_IN;
+            for (unsigned i = 0; i < ilen; i++) {
+                in[i] = test_rand();
+            }
+        } else {
+            /* a valid stream, then damaged or cut */
+            uint8_t data[MAX_OUT];
+            unsigned len = make_data(data, MAX_IN - 40);
+            ilen = sizeof(in);
+            lzfx_compress(data, len, in, &ilen);
+            if (round % 3 == 1) {
+                for (int n = test_rand() % 4; n >= 0; n--) {
+                    in[test_rand() % ilen] ^= 1 << (test_rand() % 8);
+                }
+            } else {
+                ilen = 1 + test_rand() % ilen;
+            }
+        }
+
+        unsigned osize = test_rand() % MAX_OUT;
+        compare(in, ilen, osize);
+    }
+}
+
+static void test_edges()
+{
+    uint8_t out[16];
+    unsigned olen = sizeof(out);
+    CHECK_EQ(lzfx_decompress(NULL, 0, out, &olen), 0);
+    CHECK_EQ(olen, 0);
+    CHECK_EQ(lzfx_decompress(out, 1, out, NULL), LZFX_EARGS);
+
+    /* a reference before the start of the output */
+    const uint8_t bad_ref[] = { 0x00, 'a', 0x20, 0x05 };
+    compare(bad_ref, sizeof(bad_ref), 16);
+    /* distance 1, 2 and 3 runs, long form length */
+    const uint8_t runs[] = { 0x00, 'a', 0xe0, 0x20, 0x00,
+                             0x01, 'b', 'c', 0xe0, 0x30, 0x01,
+                             0x02, 'd', 'e', 'f', 0xe0, 0x40, 0x02 };
+    compare(runs, sizeof(runs), MAX_OUT);
+    compare(runs, sizeof(runs), 60);
+}
+
+int main()
+{
+    test_seed(16);
+    test_edges();
+    test_round_trip();
+    test_led_frames();
+    test_fuzz();
+    return test_result("lzfx");
+}
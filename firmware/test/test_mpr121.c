@@ -0,0 +1,136 @@
+/*
+ * MPR121 staged config test
+ * WHowe <github.com/whowechina>
+ *
+ * mpr121_apply() has to burst only the registers that differ from the
+ * chip, inside one ECR stop/resume window, and touch nothing at all when
+ * nothing changed.
+ */
+
+#include <string.h>
+
+#include "test.h"
+#include "host.h"
+#include "mpr121.h"
+
+#define ADDR 0x5A
+#define ECR_REG 0x5E
+#define RESET_REG 0x80
+#define LOG_SIZE 32
+
+static uint8_t regs[256];
+static uint8_t ptr;
+
+/* register and length of every write, data bytes only */
+static struct {
+    uint8_t reg;
+    uint8_t len;
+    uint8_t val; // first byte
+} writes[LOG_SIZE];
+static unsigned write_num;
+
+int test_failures;
+
+static int chip_write(uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    if ((addr != ADDR) || !len) {
+        return PICO_ERROR_GENERIC;
+    }
+    ptr = src[0];
+    if (len > 1) {
+        if (write_num < LOG_SIZE) {
+            writes[write_num].reg = src[0];
+            writes[write_num].len = len - 1;
+            writes[write_num].val = src[1];
+        }
+        write_num++;
+        memcpy(&regs[src[0]], src + 1, len - 1);
+    }
+    return len;
+}
+
+static int chip_read(uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    if (addr != ADDR) {
+        return PICO_ERROR_GENERIC;
+    }
+    memcpy(dst, &regs[ptr], len);
+    return len;
+}
+
+static const host_i2c_bus_t chip = { chip_write, chip_read };
+
+static void check_window(unsigned last)
+{
+    CHECK_EQ(writes[0].reg, ECR_REG);
+    CHECK_EQ(writes[0].val, MPR121_RUN_ECR & 0xC0);
+    CHECK_EQ(writes[last].reg, ECR_REG);
+    CHECK_EQ(writes[last].val, MPR121_RUN_ECR);
+    for (int i = 1; i < last; i++) {
+        CHECK(writes[i].reg != ECR_REG);
+    }
+}
+
+static void test_init()
+{
+    CHECK(mpr121_init(ADDR));
+    CHECK_EQ(regs[ECR_REG], MPR121_RUN_ECR);
+    CHECK_EQ(writes[0].reg, RESET_REG);
+
+    /* reset, stop, then one burst per run of staged registers:
+       0x2B-0x35, 0x41-0x58, 0x5B-0x5D, 0x7B and 0x7D-0x7F, resume */
+    CHECK_EQ(write_num, 8);
+    CHECK_EQ(writes[2].reg, 0x2B);
+    CHECK_EQ(writes[2].len, 11);
+    memmove(writes, writes + 1, sizeof(writes[0]) * (write_num - 1));
+    check_window(write_num - 2);
+}
+
+static void test_unchanged()
+{
+    int8_t keys[12] = { 0 };
+    write_num = 0;
+    mpr121_apply(ADDR);
+    CHECK_EQ(write_num, 0);
+
+    /* restaging what the chip already has is no change either */
+    mpr121_sense(ADDR, 0, keys, 12);
+    mpr121_debounce(ADDR, 0, 0);
+    mpr121_apply(ADDR);
+    CHECK_EQ(write_num, 0);
+}
+
+static void test_diff_only()
+{
+    int8_t keys[12] = { 0 };
+    keys[3] = 2;
+    keys[4] = 2;
+    keys[9] = -2;
+    mpr121_sense(ADDR, 0, keys, 12);
+
+    write_num = 0;
+    mpr121_apply(ADDR);
+    CHECK_EQ(write_num, 4);
+    check_window(3);
+    CHECK_EQ(writes[1].reg, 0x41 + 3 * 2); // keys 3 and 4, one burst
+    CHECK_EQ(writes[1].len, 4);
+    CHECK_EQ(writes[2].reg, 0x41 + 9 * 2);
+    CHECK_EQ(writes[2].len, 2);
+    CHECK_EQ(regs[0x41 + 3 * 2], mpr121_touch_threshold(2));
+    CHECK_EQ(regs[0x42 + 4 * 2], mpr121_release_threshold(2));
+    CHECK_EQ(regs[0x41 + 9 * 2], mpr121_touch_threshold(-2));
+    CHECK_EQ(regs[0x41 + 5 * 2], mpr121_touch_threshold(0));
+
+    write_num = 0;
+    mpr121_apply(ADDR);
+    CHECK_EQ(write_num, 0);
+}
+
+int main()
+{
+    host_i2c_attach(&chip);
+    test_init();
+    test_unchanged();
+    test_diff_only();
+    return test_result("mpr121");
+}
@@ -0,0 +1,71 @@
+/*
+ * HID report packing equivalence test
+ * WHowe <github.com/whowechina>
+ *
+ * Joystick and NKRO reports from the published slider bitmap have to be
+ * bit for bit what the old per-pad code made of the MPR121 touch words.
+ */
+
+#include <string.h>
+
+#include "test.h"
+#include "report.h"
+#include "board_defs.h"
+#include "ref/report_ref.h"
+
+#define ROUNDS 100000
+
+int test_failures;
+
+/* what slider_update() stitches together */
+static uint32_t stitch(const uint16_t touch[3])
+{
+    return (touch[0] & 0x0fff) | ((touch[1] & 0x0fff) << 12) |
+           ((uint32_t)touch[2] << 24);
+}
+
+static void compare(const uint16_t touch[3], uint8_t airmap, uint16_t aux)
+{
+    static hid_nkro_t nkro_ref; // the old one kept state between frames
+    slider_ref_set(touch);
+
+    hid_joy_t joy, joy_ref;
+    report_gen_joy(&joy, stitch(touch), airmap, aux);
+    gen_joy_report_ref(&joy_ref, airmap, aux);
+    CHECK_EQ(joy.axis, joy_ref.axis);
+    CHECK_EQ(joy.buttons, joy_ref.buttons);
+
+    hid_nkro_t nkro;
+    report_gen_nkro(&nkro, stitch(touch), airmap, aux);
+    gen_nkro_report_ref(&nkro_ref, airmap, aux);
+    CHECK(memcmp(nkro.keymap, nkro_ref.keymap, sizeof(nkro.keymap)) == 0);
+}
+
+int main()
+{
+    report_nkro_keymap(NKRO_KEYMAP);
+
+    /* every single pad, every air and aux combination */
+    for (int pad = 0; pad < 32; pad++) {
+        uint16_t touch[3] = { 0 };
+        touch[pad / 12] = 1 << (pad % 12);
+        compare(touch, 0, 0);
+    }
+    for (int air = 0; air < 64; air++) {
+        for (int aux = 0; aux < 8; aux++) {
+            uint16_t touch[3] = { 0 };
+            compare(touch, air, aux);
+        }
+    }
+
+    test_seed(10);
+    for (int i = 0; i < ROUNDS; i++) {
+        uint16_t touch[3] = { test_rand() & 0x0fff, test_rand() & 0x0fff,
+                              test_rand() & 0x00ff };
+        compare(touch, test_rand() & 0x3f, test_rand() & 0x07);
+        if (test_failures) {
+            break;
+        }
+    }
+    return test_result("report");
+}
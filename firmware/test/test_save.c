@@ -0,0 +1,374 @@
+/*
+ * Config journal test on simulated flash
+ * WHowe <github.com/whowechina>
+ *
+ * Every boot is a fresh child process over a shared flash image, so
+ * save.c starts from nothing just like after a real power cycle.
+ * Measures erases per 1000 edits, then cuts power in the middle of
+ * flash operations and checks a boot always finds either the config
+ * from before the cut save or the one it was writing. Saves while input
+ * goes on must not hold up an input frame for a sector erase.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "test.h"
+#include "host.h"
+#include "save.h"
+#include "hardware/flash.h"
+
+#define CFG_SIZE 200
+#define AUX_SIZE 60 // past the end of a legacy page
+#define MAGIC 0xca34cafe
+#define EDITS 1000
+#define EDITS_PER_BOOT 100
+#define POWER_CUTS 2000
+#define EXIT_CUT 42
+#define FRAME_US 1000
+#define SAVE_FRAMES_MAX 70000 // SAVE_MAX_DEFER_US in save.c and then some
+#define QUIET_FRAMES 4000     // SAVE_QUIET_US and then some
+/* journal entries of a whole image in a sector, compaction's included */
+#define ENTRIES_PER_SECTOR ((FLASH_SECTOR_SIZE - 10) / (2 + 4 + CFG_SIZE + 4 + AUX_SIZE + 2))
+
+/* shared between all boots */
+static struct {
+    uint8_t cfg[CFG_SIZE];
+    uint8_t aux[AUX_SIZE];
+    uint8_t alt[CFG_SIZE]; // also fine, while a save was being cut
+    bool alt_ok;
+    uint32_t rand_state;
+    uint32_t erases;
+    uint32_t programs;
+    uint32_t saves;
+    uint32_t max_gap;
+    uint32_t erase_gap;
+} *shared;
+
+int test_failures;
+
+static uint8_t cfg_default[CFG_SIZE];
+static uint8_t aux_default[AUX_SIZE];
+static uint8_t *cfg;
+static uint8_t *aux;
+static mutex_t io_lock;
+
+static void loaded()
+{
+}
+
+static void boot()
+{
+    memset(cfg_default, 0x07, sizeof(cfg_default));
+    memset(aux_default, 0x09, sizeof(aux_default));
+    cfg = save_alloc(CFG_SIZE, cfg_default, loaded);
+    aux = save_alloc(AUX_SIZE, aux_default, loaded);
+    mutex_init(&io_lock);
+    host_time_step(100);
+    host_time_set(1000000);
+    save_init(MAGIC, &io_lock);
+}
+
+static uint32_t shared_rand()
+{
+    test_rand_state = shared->rand_state;
+    uint32_t r = test_rand();
+    shared->rand_state = test_rand_state;
+    return r;
+}
+
+/* Lets the pending save run to the end, one flash op per loop */
+static bool settle()
+{
+    save_stat_t before;
+    save_stat(&before);
+    host_time_advance(70000000);
+    for (int i = 0; i < 200; i++) {
+        save_loop();
+        save_stat_t now;
+        save_stat(&now);
+        if (now.saves != before.saves) {
+            return true;
+        }
+        host_time_advance(1000);
+    }
+    return false;
+}
+
+static bool boot_matches()
+{
+    if (memcmp(aux, shared->aux, AUX_SIZE) != 0) {
+        return false;
+    }
+    if (memcmp(cfg, shared->cfg, CFG_SIZE) == 0) {
+        return true;
+    }
+    if (shared->alt_ok && (memcmp(cfg, shared->alt, CFG_SIZE) == 0)) {
+        memcpy(shared->cfg, shared->alt, CFG_SIZE);
+        return true;
+    }
+    return false;
+}
+
+/* always a real change, an unchanged config isn't saved at all */
+static void edit()
+{
+    cfg[shared_rand() % CFG_SIZE] ^= 1 + shared_rand() % 255;
+    if (shared_rand() % 4 == 0) {
+        memset(cfg + shared_rand() % (CFG_SIZE - 60), shared_rand(), 60);
+    }
+    if (shared_rand() % 8 == 0) {
+        aux[shared_rand() % AUX_SIZE] ^= 1 + shared_rand() % 255;
+    }
+}
+
+static void power_cut()
+{
+    _exit(EXIT_CUT);
+}
+
+/* Returns the exit code of one boot running session() */
+static int power_cycle(int (*session)(int), int arg)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout); // save.c is chatty
+        boot();
+        if (!boot_matches()) {
+            fprintf(stderr, "boot found the wrong config\n");
+            _exit(1);
+        }
+        shared->alt_ok = false;
+        _exit(session(arg));
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 2;
+}
+
+static int edit_session(int edits)
+{
+    host_flash_stat_t start;
+    host_flash_stat(&start);
+
+    for (int i = 0; i < edits; i++) {
+        edit();
+        save_request(false);
+        if (!settle()) {
+            fprintf(stderr, "save never finished\n");
+            return 1;
+        }
+        memcpy(shared->cfg, cfg, CFG_SIZE);
+        memcpy(shared->aux, aux, AUX_SIZE);
+        shared->saves++;
+    }
+
+    host_flash_stat_t end;
+    host_flash_stat(&end);
+    shared->erases += end.erases - start.erases;
+    shared->programs += end.programs - start.programs;
+    return 0;
+}
+
+static int cut_session(int cut_point)
+{
+    uint8_t before_aux[AUX_SIZE];
+    memcpy(before_aux, aux, AUX_SIZE);
+    edit();
+    if (memcmp(before_aux, aux, AUX_SIZE) != 0) {
+        memcpy(aux, before_aux, AUX_SIZE); // only cfg may differ after a cut
+    }
+    memcpy(shared->alt, cfg, CFG_SIZE);
+    shared->alt_ok = true;
+
+    host_flash_cut(cut_point, power_cut);
+    save_request(false);
+    if (!settle()) {
+        return 1;
+    }
+    memcpy(shared->cfg, cfg, CFG_SIZE);
+    shared->alt_ok = false;
+    return 0;
+}
+
+/* One input frame, the way core0_loop() runs save.c */
+static void run_frame(bool input)
+{
+    static uint64_t frame_at;
+    uint64_t now = time_us_64();
+    frame_at = now > frame_at + FRAME_US ? now : frame_at + FRAME_US;
+    host_time_set(frame_at);
+
+    save_frame();
+    if (input) {
+        save_hold();
+    }
+    save_loop();
+}
+
+/* every byte changes, so every save is a whole image sized entry */
+static void edit_all()
+{
+    static uint8_t v;
+    v++;
+    memset(cfg, v, CFG_SIZE);
+    memset(aux, v, AUX_SIZE);
+}
+
+static uint32_t save_frames(bool input)
+{
+    save_request(false);
+    save_stat_t before;
+    save_stat(&before);
+    uint32_t max_gap = 0;
+    for (int i = 0; i < SAVE_FRAMES_MAX; i++) {
+        run_frame(input);
+        save_stat_t now;
+        save_stat(&now);
+        max_gap = now.last_stall_us > max_gap ? now.last_stall_us : max_gap;
+        if (now.saves != before.saves) {
+            return max_gap;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static uint32_t erases()
+{
+    host_flash_stat_t stat;
+    host_flash_stat(&stat);
+    return stat.erases;
+}
+
+/* Whole sectors of saves while input never stops, the forced ones after
+   SAVE_MAX_DEFER_US. The sector erase is done ahead when it's quiet, so
+   input frames only ever wait for a page program. */
+static int gap_session(int arg)
+{
+    for (int i = 0; i < ENTRIES_PER_SECTOR * 2; i++) {
+        edit_all();
+        if (save_frames(false) == UINT32_MAX) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < QUIET_FRAMES; i++) {
+        run_frame(false);
+    }
+
+    uint32_t erased = erases();
+    uint32_t max_gap = 0;
+    for (int i = 0; i < ENTRIES_PER_SECTOR; i++) { // one compaction
+        edit_all();
+        uint32_t gap = save_frames(true);
+        max_gap = gap > max_gap ? gap : max_gap;
+    }
+    if (erases() != erased) {
+        fprintf(stderr, "erased while input was going on\n");
+        return 1;
+    }
+    if (max_gap >= FRAME_US * 2) {
+        fprintf(stderr, "input frames %u us apart while saving\n", max_gap);
+        return 1;
+    }
+
+    /* the sector the compaction left gets erased once it's quiet */
+    for (int i = 0; i < QUIET_FRAMES; i++) {
+        run_frame(false);
+    }
+    save_stat_t stat;
+    save_stat(&stat);
+    if ((erases() != erased + 1) || (stat.last_stall_us < HOST_FLASH_ERASE_US)) {
+        fprintf(stderr, "the spare sector wasn't erased when quiet\n");
+        return 1;
+    }
+
+    shared->max_gap = max_gap;
+    shared->erase_gap = stat.last_stall_us;
+    memcpy(shared->cfg, cfg, CFG_SIZE);
+    memcpy(shared->aux, aux, AUX_SIZE);
+    return 0;
+}
+
+static int nothing(int arg)
+{
+    return 0;
+}
+
+static void test_wear()
+{
+    /* first boot writes the defaults */
+    CHECK_EQ(power_cycle(edit_session, 1), 0);
+    shared->erases = 0;
+    shared->programs = 0;
+    shared->saves = 0;
+
+    for (int done = 0; done < EDITS; done += EDITS_PER_BOOT) {
+        CHECK_EQ(power_cycle(edit_session, EDITS_PER_BOOT), 0);
+    }
+    CHECK_EQ(shared->saves, EDITS);
+    printf("erases per %d edits: %u (single page rewrites: %u), pages programmed: %u\n",
+           EDITS, shared->erases, EDITS / (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE),
+           shared->programs);
+    CHECK(shared->erases <= EDITS / 100);
+}
+
+static void test_power_cut()
+{
+    int cuts = 0;
+    for (int i = 0; i < POWER_CUTS; i++) {
+        int rc = power_cycle(cut_session, shared_rand() % 6);
+        CHECK((rc == 0) || (rc == EXIT_CUT));
+        cuts += (rc == EXIT_CUT);
+    }
+    CHECK_EQ(power_cycle(nothing, 0), 0);
+    printf("%d power cuts, every boot found a whole config\n", cuts);
+}
+
+/* A page in the last sector the way older firmware saved it */
+static void test_legacy()
+{
+    uint8_t *image = host_flash_image();
+    memset(image, 0xff, PICO_FLASH_SIZE_BYTES);
+
+    uint8_t *page = image + PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE;
+    uint32_t magic = MAGIC;
+    memcpy(page, &magic, 4);
+    memset(page + 4, 0x55, CFG_SIZE);
+    memset(page + 4 + CFG_SIZE, 0x66, FLASH_PAGE_SIZE - 4 - CFG_SIZE);
+
+    /* cfg comes from the page, aux doesn't fit in it and starts default */
+    memset(shared->cfg, 0x55, CFG_SIZE);
+    memset(shared->aux, 0x09, AUX_SIZE);
+    CHECK_EQ(power_cycle(edit_session, 3), 0);
+    CHECK_EQ(power_cycle(nothing, 0), 0);
+}
+
+int main()
+{
+    shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    uint8_t *image = mmap(NULL, PICO_FLASH_SIZE_BYTES, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if ((shared == MAP_FAILED) || (image == MAP_FAILED)) {
+        return 1;
+    }
+    memset(image, 0xff, PICO_FLASH_SIZE_BYTES);
+    host_flash_use(image);
+
+    memset(shared, 0, sizeof(*shared));
+    memset(shared->cfg, 0x07, CFG_SIZE);
+    memset(shared->aux, 0x09, AUX_SIZE);
+    shared->rand_state = 21;
+
+    test_wear();
+    test_power_cut();
+    CHECK_EQ(power_cycle(gap_session, 0), 0);
+    printf("input frame gap while saving: %u us, %u us for a quiet erase\n",
+           shared->max_gap, shared->erase_gap);
+    test_legacy();
+    return test_result("save");
+}
@@ -0,0 +1,99 @@
+/*
+ * Sensor Trace Files, host side
+ * WHowe <github.com/whowechina>
+ */
+
+#include "trace_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BASELINE_FRAMES 16
+
+static uint8_t checksum(const trace_frame_t *frame)
+{
+    uint8_t sum = 0;
+    const uint8_t *data = (const uint8_t *)frame;
+    for (int i = 0; i < sizeof(*frame) - 1; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+void trace_seal(trace_frame_t *frame)
+{
+    frame->sync[0] = TRACE_SYNC0;
+    frame->sync[1] = TRACE_SYNC1;
+    frame->len = sizeof(*frame);
+    frame->checksum = checksum(frame);
+}
+
+int trace_parse(const uint8_t *data, size_t len, trace_frame_t *frames, int max)
+{
+    int num = 0;
+    size_t i = 0;
+    while ((i + sizeof(trace_frame_t) <= len) && (num < max)) {
+        if ((data[i] != TRACE_SYNC0) || (data[i + 1] != TRACE_SYNC1) ||
+            (data[i + 2] != sizeof(trace_frame_t))) {
+            i++;
+            continue;
+        }
+        trace_frame_t *frame = &frames[num];
+        memcpy(frame, data + i, sizeof(*frame));
+        if (frame->checksum != checksum(frame)) {
+            i++;
+            continue;
+        }
+        num++;
+        i += sizeof(*frame);
+    }
+    return num;
+}
+
+int trace_load(const char *path, trace_frame_t **frames)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    uint8_t *data = malloc(len > 0 ? len : 1);
+    if (!data || (fread(data, 1, len, fp) != len)) {
+        free(data);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    int max = len / sizeof(trace_frame_t);
+    *frames = malloc((max > 0 ? max : 1) * sizeof(trace_frame_t));
+    int num = trace_parse(data, len, *frames, max);
+    free(data);
+    return num;
+}
+
+bool trace_save(const char *path, const trace_frame_t *frames, int num)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+    bool ok = fwrite(frames, sizeof(*frames), num, fp) == num;
+    return (fclose(fp) == 0) && ok;
+}
+
+void trace_baseline(const trace_frame_t *frames, int num, uint8_t *baseline)
+{
+    int n = num < BASELINE_FRAMES ? num : BASELINE_FRAMES;
+    for (int i = 0; i < TRACE_PAD_NUM; i++) {
+        uint32_t sum = 0;
+        for (int f = 0; f < n; f++) {
+            sum += frames[f].filtered[i];
+        }
+        baseline[i] = n ? (sum / n) >> 2 : 0;
+    }
+}
@@ -0,0 +1,29 @@
+/*
+ * Sensor Trace Files, host side
+ * WHowe <github.com/whowechina>
+ */
+
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "trace.h"
+
+/* Sets sync, len and checksum, like the firmware sends it */
+void trace_seal(trace_frame_t *frame);
+
+/* Picks frames out of a raw CDC capture, anything in between (CLI echo,
+   broken frames) is skipped. Returns the number of frames found. */
+int trace_parse(const uint8_t *data, size_t len, trace_frame_t *frames, int max);
+
+/* Whole capture file, frames are malloc'ed. Returns -1 if unreadable */
+int trace_load(const char *path, trace_frame_t **frames);
+bool trace_save(const char *path, const trace_frame_t *frames, int num);
+
+/* Captures have no MPR121 baseline, take it from the idle start */
+void trace_baseline(const trace_frame_t *frames, int num, uint8_t *baseline);
+
+#endif
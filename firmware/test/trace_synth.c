@@ -0,0 +1,142 @@
+/*
+ * Scripted Synthetic Sensor Traces
+ * WHowe <github.com/whowechina>
+ */
+
+#include "trace_synth.h"
+
+#include <string.h>
+
+#include "trace_file.h"
+
+/* a finger still reaches pads 1.5 pads away from its center */
+#define FINGER_SPREAD 384
+
+/* default config: ToF keys from 800 up by 200, IR 3800 trips at -20% */
+#define TOF_OFFSET 800
+#define TOF_PITCH 200
+#define TOF_NOTHING 6390 // GP2Y0E's farthest
+#define IR_CLEAR 3800
+#define IR_BLOCKED 1500
+#define MPR121_TOUCH 22
+#define MPR121_RELEASE 15
+
+static uint32_t state;
+
+static uint32_t next_rand()
+{
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+int synth_finger_pos(const synth_finger_t *finger, uint32_t frame)
+{
+    if ((frame < finger->from) || (frame >= finger->to)) {
+        return -1;
+    }
+    int span = finger->to - finger->from;
+    int at = frame - finger->from;
+    return finger->pos_from + (finger->pos_to - finger->pos_from) * at / span;
+}
+
+int synth_hand_level(const synth_hand_t *hand, uint32_t frame)
+{
+    if ((frame < hand->from) || (frame >= hand->to)) {
+        return -1;
+    }
+    return hand->level;
+}
+
+static int noise(int amplitude)
+{
+    if (!amplitude) {
+        return 0;
+    }
+    return (int)(next_rand() % (amplitude * 2 + 1)) - amplitude;
+}
+
+static void synth_air(const synth_script_t *script, trace_frame_t *frame,
+                      uint32_t f)
+{
+    int level = -1;
+    for (int k = 0; k < script->hand_num; k++) {
+        int l = synth_hand_level(&script->hand[k], f);
+        level = l > level ? l : level;
+    }
+
+    if (script->ir) {
+        frame->flags |= TRACE_FLAG_IR;
+        for (int i = 0; i < TRACE_IR_NUM; i++) {
+            frame->ir[i] = (i == level ? IR_BLOCKED : IR_CLEAR) +
+                           noise(script->air_noise);
+        }
+        return;
+    }
+
+    /* mid-way into the level, every sensor sees the same hand */
+    for (int i = 0; i < TRACE_TOF_NUM; i++) {
+        frame->tof[i] = level < 0 ? TOF_NOTHING : TOF_OFFSET + level * TOF_PITCH +
+                        TOF_PITCH / 2 + noise(script->air_noise);
+    }
+}
+
+static int finger_delta(const synth_script_t *script, uint32_t frame, int pad)
+{
+    int delta = 0;
+    for (int k = 0; k < script->finger_num; k++) {
+        int pos = synth_finger_pos(&script->finger[k], frame);
+        if (pos < 0) {
+            continue;
+        }
+        int d = pos - SYNTH_PAD(pad);
+        d = d < 0 ? -d : d;
+        if (d < FINGER_SPREAD) {
+            delta += script->finger[k].depth * (FINGER_SPREAD - d) / FINGER_SPREAD;
+        }
+    }
+    return delta;
+}
+
+void synth_trace(const synth_script_t *script, trace_frame_t *frames,
+                 int num, uint8_t baseline[TRACE_PAD_NUM])
+{
+    state = script->seed ? script->seed : 1;
+    for (int i = 0; i < TRACE_PAD_NUM; i++) {
+        baseline[i] = 150 + next_rand() % 40;
+    }
+
+    for (int f = 0; f < num; f++) {
+        trace_frame_t *frame = &frames[f];
+        memset(frame, 0, sizeof(*frame));
+        frame->flags = TRACE_FLAG_FILTERED;
+        frame->time_us = f * SYNTH_FRAME_US;
+
+        int spike_pad = -1;
+        if (script->spike_rate && (next_rand() % script->spike_rate == 0)) {
+            spike_pad = next_rand() % TRACE_PAD_NUM;
+        }
+        int drift = num ? script->drift * f / num : 0;
+
+        for (int i = 0; i < TRACE_PAD_NUM; i++) {
+            int v = (baseline[i] << 2) + drift - finger_delta(script, f, i);
+            v += noise(script->noise);
+            if (i == spike_pad) {
+                v -= script->spike;
+            }
+            v = v < 0 ? 0 : (v > 0x3ff ? 0x3ff : v);
+            frame->filtered[i] = v;
+            /* what MPR121 sees with its default thresholds */
+            int delta = (baseline[i] << 2) - v;
+            bool was = (f > 0) && (frames[f - 1].touched[i / 12] & (1 << (i % 12)));
+            if (was ? (delta > MPR121_RELEASE) : (delta >= MPR121_TOUCH)) {
+                frame->touched[i / 12] |= 1 << (i % 12);
+            }
+        }
+        synth_air(script, frame, f);
+        trace_seal(frame);
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Scripted Synthetic Sensor Traces
+ * WHowe <github.com/whowechina>
+ *
+ * Stand-ins for cabinet captures with a known ground truth
+ */
+
+#ifndef TRACE_SYNTH_H
+#define TRACE_SYNTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "trace.h"
+
+#define SYNTH_FINGER_MAX 4
+#define SYNTH_HAND_MAX 8
+#define SYNTH_FRAME_US 1000
+
+/* Pad positions are Q8, pad i spans i * 256 to i * 256 + 255 */
+#define SYNTH_PAD(i) ((i) * 256 + 128)
+
+typedef struct {
+    uint32_t from, to;    // frames, to is exclusive
+    int pos_from, pos_to; // slides linearly in between
+    int depth;            // delta on the pad right under it
+} synth_finger_t;
+
+typedef struct {
+    uint32_t from, to;
+    int level;            // air key 0..5 the hand is at
+} synth_hand_t;
+
+typedef struct {
+    uint32_t seed;
+    int noise;      // +/- counts on every pad, every frame
+    int spike;      // single frame dips on a random pad
+    int spike_rate; // one in this many frames, 0 for none
+    int drift;      // counts the whole trace drifts by
+    int finger_num;
+    synth_finger_t finger[SYNTH_FINGER_MAX];
+    bool ir;        // air by IR beams, otherwise ToF distances
+    int air_noise;  // +/- on ToF distances and IR ADC readings
+    int hand_num;
+    synth_hand_t hand[SYNTH_HAND_MAX];
+} synth_script_t;
+
+/* Baseline is what the MPR121 would have settled to. Air readings
+   assume the default ToF offset/pitch and IR base/trigger. */
+void synth_trace(const synth_script_t *script, trace_frame_t *frames,
+                 int num, uint8_t baseline[TRACE_PAD_NUM]);
+
+/* Ground truth, position in Q8 pads or -1 if the finger is up */
+int synth_finger_pos(const synth_finger_t *finger, uint32_t frame);
+/* Ground truth, air key level or -1 if the hand is away */
+int synth_hand_level(const synth_hand_t *hand, uint32_t frame);
+
+#endif